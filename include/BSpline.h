@@ -12,6 +12,7 @@ class BSpline : public Curve
 {
 public:
   BSpline::BSpline() :
+    Curve( CurveType::BSPLINE ),
     is_uni_( false ),
     is_open_( false )
   {}
@@ -19,25 +20,27 @@ public:
   BSpline::BSpline( int order,
                     const point_vec &ctrl_pnts,
                     const double_vec &knots ) :
-    Curve( order, ctrl_pnts),
-    knots_( knots ),
+    Curve( CurveType::BSPLINE, order, ctrl_pnts),
+    knots_( knots, get_crv_resource() ),
     is_uni_( false ),
     is_open_( false )
   {}
 
-  virtual void dump( std::ofstream &ofs ) const;
-  void dumpKnots( std::ofstream &ofs ) const;
+  virtual void dump( TextBuffer &buf ) const;
+  void dumpKnots( TextBuffer &buf ) const;
 
   virtual CAGD_POINT evaluate( double t ) const;
 
-  virtual void show_ctrl_poly();
   virtual bool show_crv( int chg_ctrl_idx = K_NOT_USED,
-                         CtrlOp op = CtrlOp::NONE ) const;
+                         CtrlOp op = CtrlOp::NONE );
+
+  virtual bool sample_crv( point_vec &pnts ) const;
+  virtual bool get_ctrl_poly_pnts( point_vec &pnts ) const;
 
   virtual void print() const;
   virtual void add_ctrl_pnt( CAGD_POINT &ctrl_pnt, int idx );
   virtual void rmv_ctrl_pnt( int idx );
-  void show_crv_helper( std::vector< int > u_vec ) const;
+  void show_crv_helper( std::vector< int > u_vec );
 
   virtual bool is_miss_ctrl_pnts() const
   {
@@ -45,6 +48,9 @@ public:
   }
 
   void insertKnot( double u );
+
+  // inserts the sorted knots in one pass, false if one is outside the domain
+  bool refineKnotVector( const double_vec &new_knots );
   void update_u_vec();
 
   void makeUniformKnotVector( bool use = false, double mn = 0.0, double mx = 1.0 );
@@ -71,6 +77,26 @@ public:
 
   void addKnot( double new_knot );
   void rmvKnot( int knot_idx );
+
+  // Removes the interior knot u up to num times while the curve stays within
+  // tol of its shape, err receives how far it moved. Returns the number of
+  // removals.
+  int removeKnot( double u, int num, double tol, double &err );
+
+  // removes as many interior knots as the curve allows within tol in all
+  int removeKnots( double tol );
+
+  // makes the end knots order_ fold, the curve does not change
+  bool clampKnots();
+
+  // Clamps and splits the curve into Bezier segments, every interior knot
+  // gets order_ - 1 fold. joints receives the distinct interior knots and
+  // joint_mults how many times each one was there before. On failure the
+  // curve is left unchanged.
+  bool decomposeToBezier( double_vec &joints, int_vec &joint_mults );
+
+  virtual bool elevateDegree( int times );
+  virtual bool reduceDegree( double tol, double &err );
   void updateKnot( int knot_idx, double new_param );
   void ensureNonDecreasingKnotVector();
   void updateUniqueKnotsAndMultiplicity();
@@ -80,9 +106,9 @@ public:
   const char *getKnotsDescription() const;
   bool parseKnotsDescription( const std::string &description );
 
-  double_vec knots_;
-  double_vec u_vec_;
-  double_vec multiplicity_;
+  double_vec knots_{ get_crv_resource() };
+  double_vec u_vec_{ get_crv_resource() };
+  double_vec multiplicity_{ get_crv_resource() };
   bool is_uni_;
   bool is_open_;
 };
@@ -9,16 +9,19 @@ class BSpline;
 class Bezier : public Curve
 {
 public:
-  Bezier(){}
+  Bezier() : Curve( CurveType::BEZIER ) {}
 
   Bezier( int order,
           const point_vec &ctrl_pnts ) :
-    Curve( order, ctrl_pnts) {}
+    Curve( CurveType::BEZIER, order, ctrl_pnts) {}
 
   virtual CAGD_POINT evaluate( GLdouble t ) const;
+  virtual void update_eval_cache();
 
   virtual bool show_crv( int chg_ctrl_idx = K_NOT_USED,
-                         CtrlOp op = CtrlOp::NONE ) const;
+                         CtrlOp op = CtrlOp::NONE );
+
+  virtual bool sample_crv( point_vec &pnts ) const;
 
   virtual void print() const;
   virtual void add_ctrl_pnt( CAGD_POINT &ctrl_pnt, int idx );
@@ -29,6 +32,9 @@ public:
     return ctrl_pnts_.size() < ( size_t )order_;
   }
 
+  virtual bool elevateDegree( int times );
+  virtual bool reduceDegree( double tol, double &err );
+
   void connectSmoothBezier( const Bezier *other, bool isG1 );
   virtual void connectC0_bezier( const Bezier *other );
   virtual void connectC1_bezier( const Bezier *other );
@@ -39,10 +45,46 @@ public:
   virtual void connectC1_bspline( const BSpline *bspline );
   virtual void connectG1_bspline( const BSpline *bspline );
 
-  void computeMP() const;
+  void computeMP( point_vec &MP, double_vec &MW ) const;
   void calculateMatrixM( std::vector<std::vector<GLdouble>> &M ) const;
 
 private:
-  mutable std::vector< CAGD_POINT > MP_cache_;
-  mutable std::vector< double >     MW_cache_;
+  bool is_cache_valid() const;
+  CAGD_POINT evaluateMP( const point_vec &MP,
+                         const double_vec &MW,
+                         GLdouble t ) const;
+
+  // rebuilt by update_eval_cache, never written by const members. Control
+  // points are written directly in many places, so the cache keeps the points
+  // it was built from and is only used while they are still the same
+  point_vec  MP_cache_{ get_crv_resource() };
+  double_vec MW_cache_{ get_crv_resource() };
+  point_vec  cache_pnts_{ get_crv_resource() };
 };
+
+// Points as x * w, y * w, w and back, the degree changes are done on these.
+void to_hom_pnts( const point_vec &pnts, point_vec &pw );
+void from_hom_pnts( const point_vec &pw, point_vec &pnts );
+
+// For points of two curves in the same basis
+//   | x1 / w1 - x2 / w2 | <= ( | x1 - x2 | + | x1 / w1 | * | w1 - w2 | ) / w2
+// so the homogeneous control points differing by at most dxy in x * w, y * w
+// and dw in w bound how far the curves are apart, with max_len the largest
+// | x / w | of the first curve's control points and w_min the smallest weight
+// of the second's.
+typedef struct
+{
+  double dxy;
+  double dw;
+} HomDiff;
+
+void add_hom_diff( const CAGD_POINT &a, const CAGD_POINT &b, HomDiff &diff );
+double hom_diff_to_crv( const HomDiff &diff, double max_len, double w_min );
+double max_crv_len( const point_vec &ctrl_pnts );
+double min_weight( const point_vec &pnts );
+
+// Degree change of the Bezier segment pw into another vector. Elevation is
+// exact, reduction adds how far the control points moved to diff and fails if
+// a weight would not stay positive.
+void elevate_bezier_hom( const point_vec &pw, point_vec &elevated );
+bool reduce_bezier_hom( const point_vec &pw, point_vec &reduced, HomDiff &diff );
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Blocking FIFO with a fixed capacity, connects pipeline stages. push waits
+// while the queue is full, so a fast producer cannot run ahead of its
+// consumers. After close, push drops values and pop drains what is left and
+// then returns false.
+template< typename T >
+class BoundedQueue
+{
+public:
+  BoundedQueue( size_t capacity ) : capacity_( capacity ), is_closed_( false ) {}
+
+  bool push( T &&value )
+  {
+    std::unique_lock< std::mutex > lock( mtx_ );
+    not_full_.wait( lock, [ this ] { return is_closed_ || items_.size() < capacity_; } );
+
+    if( is_closed_ )
+      return false;
+
+    items_.push_back( std::move( value ) );
+    not_empty_.notify_one();
+    return true;
+  }
+
+  bool pop( T &value )
+  {
+    std::unique_lock< std::mutex > lock( mtx_ );
+    not_empty_.wait( lock, [ this ] { return is_closed_ || !items_.empty(); } );
+
+    if( items_.empty() )
+      return false;
+
+    value = std::move( items_.front() );
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  void close()
+  {
+    std::lock_guard< std::mutex > lock( mtx_ );
+    is_closed_ = true;
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+private:
+  std::mutex mtx_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque< T > items_;
+  size_t capacity_;
+  bool is_closed_;
+};
@@ -17,14 +17,29 @@ typedef struct
   GLdouble x, y, z;
 } CAGD_POINT;
 
+typedef struct SEG_TABLE CAGD_SEG_TABLE; /* opaque, see cagdCreateSegTable */
+
+typedef struct
+{ /* how the window looks at the scene */
+  GLdouble modelView[ 16 ];
+  GLdouble sensitive;
+  GLint    fuzziness;
+  WORD     view;
+  BOOL     cue;
+} CAGD_VIEW_STATE;
+
 enum
 { /* supported types of segment */
   CAGD_SEGMENT_UNUSED = 0,
   CAGD_SEGMENT_POINT,
   CAGD_SEGMENT_TEXT,
-  CAGD_SEGMENT_POLYLINE
+  CAGD_SEGMENT_POLYLINE,
+  CAGD_SEGMENT_POINTS,
+  CAGD_SEGMENT_MESH
 };
 
+#define CAGD_NO_INDEX ( ( UINT )-1 ) /* picked segment has no sub-element */
+
 enum
 { /* events to register callback functions with */
   CAGD_LBUTTONDOWN = 0,
@@ -39,6 +54,7 @@ enum
   CAGD_LOADFILE,
   CAGD_SAVEFILE,
   CAGD_SAVE_CURVE,
+  CAGD_VIEWCHANGE, /* model view or window size changed */
   CAGD_LAST
 };
 
@@ -79,7 +95,17 @@ enum
   CAGD_CHANGE_WEIGHT,
   CAGD_ADD_BEZIER_CURVE,
   CAGD_ADD_BSPLINE_CURVE,
-  CAGD_HIDE_CTRL_POLYS
+  CAGD_HIDE_CTRL_POLYS,
+  CAGD_UNDO,
+  CAGD_REDO,
+  CAGD_CANCEL_LOAD,
+  CAGD_PACK_SAVES,
+  CAGD_AUTOSAVE,
+  CAGD_TESS_CACHE,
+  CAGD_REDUCE_KNOTS,
+  CAGD_REDUCE_ALL_KNOTS,
+  CAGD_ELEVATE_DEGREE,
+  CAGD_REDUCE_DEGREE
 };
 
 #ifdef __cplusplus
@@ -179,6 +205,20 @@ extern "C" {
   void cagdSetView( WORD );
   BOOL cagdGetDepthCue();
   void cagdSetDepthCue( BOOL enable );
+  /************************************************************************
+  * DESCRIPTION:								M
+  *   Saves and restores the model view matrix, projection, depth cue,	M
+  *   fuzziness and sensitivity all at once, e.g. to reopen a session	M
+  *   the way it was left.						M
+  *									*
+  * PARAMETERS:								M
+  *   state	receives / holds the view state;			M
+  *									*
+  * RETURN VALUE:								M
+  *   None;								M
+  ************************************************************************/
+  void cagdGetViewState( CAGD_VIEW_STATE *state );
+  void cagdSetViewState( const CAGD_VIEW_STATE *state );
   BOOL cagdToObject( int, int, CAGD_POINT[ 2 ] );
   BOOL cagdToWindow( CAGD_POINT *, int *, int * );
   void cagdGetMoveVec( int dX, int dY, double &x, double &y );
@@ -195,16 +235,59 @@ extern "C" {
   BOOL cagdIsSegmentVisible( UINT );
   BOOL cagdFreeSegment( UINT );
   void cagdFreeAllSegments();
+  /************************************************************************
+  * DESCRIPTION:								M
+  *   Segment functions work on the segment table selected by the	M
+  *   calling thread. Every thread starts with the default table, which	M
+  *   is the one drawn in the window. A thread that builds a scene of	M
+  *   its own creates a table, selects it, and destroys it when done.	M
+  *   Destroying a table frees all of its segments.			M
+  *									*
+  * PARAMETERS:								M
+  *   table	table to select, NULL selects the default table;	M
+  *									*
+  * RETURN VALUE:								M
+  *   cagdSelectSegTable returns the previously selected table;		M
+  ************************************************************************/
+  CAGD_SEG_TABLE *cagdCreateSegTable();
+  void cagdDestroySegTable( CAGD_SEG_TABLE *table );
+  CAGD_SEG_TABLE *cagdSelectSegTable( CAGD_SEG_TABLE *table );
+  CAGD_SEG_TABLE *cagdGetSegTable();
   UINT cagdGetSegmentType( UINT );
   UINT cagdGetSegmentLength( UINT );
   BOOL cagdGetSegmentLocation( UINT, CAGD_POINT * );
   void cagdPick( int, int );
   UINT cagdPickNext();
   /************************************************************************
+  * DESCRIPTION:								M
+  *   Same as cagdPickNext, also reports which point of a		M
+  *   CAGD_SEGMENT_POINTS segment was hit.					M
+  *									*
+  * PARAMETERS:								M
+  *   index	receives the point's index, or CAGD_NO_INDEX for other	M
+  *		segment types (may be NULL);				M
+  *									*
+  * RETURN VALUE:								M
+  *   ID of picked segment, 0 if there are no more hits;			M
+  ************************************************************************/
+  UINT cagdPickNextIndex( UINT *index );
+  /************************************************************************
   * Point segment functions						*
   ************************************************************************/
   UINT cagdAddPoint( const CAGD_POINT * );
   BOOL cagdReusePoint( UINT, const CAGD_POINT * );
+  UINT cagdAddPoints( const CAGD_POINT *, UINT, UINT * );
+
+  /************************************************************************
+  * Point set segment functions						*
+  ************************************************************************/
+  UINT cagdAddPointSet( const CAGD_POINT *, UINT );
+  BOOL cagdReusePointSet( UINT, const CAGD_POINT *, UINT );
+  UINT cagdAddPointSets( const CAGD_POINT *const *, const UINT *, UINT, UINT * );
+  BOOL cagdSetPointColor( UINT, UINT, BYTE, BYTE, BYTE );
+  BOOL cagdResetPointColor( UINT, UINT );
+  BOOL cagdShowPoint( UINT, UINT );
+  BOOL cagdHidePoint( UINT, UINT );
 
   /************************************************************************
   * Text segment functions						*
@@ -217,10 +300,57 @@ extern "C" {
   * Polyline segment functions						*
   ***********************************************************************/
   UINT cagdAddPolyline( const CAGD_POINT *, UINT );
+  /************************************************************************
+  * DESCRIPTION:								M
+  *   Adds count polylines at once, allocating the segment table and	M
+  *   the vertices once for the whole batch. Polylines shorter than 2	M
+  *   vertices are skipped. cagdAddPoints and cagdAddPointSets are the	M
+  *   point counterparts.							M
+  *									*
+  * PARAMETERS:								M
+  *   where	count vertex arrays;					M
+  *   lengths	count vertex array lengths;				M
+  *   count	number of polylines;					M
+  *   ids	receives count IDs, 0 for skipped polylines;		M
+  *									*
+  * RETURN VALUE:								M
+  *   Number of added segments;						M
+  ************************************************************************/
+  UINT cagdAddPolylines( const CAGD_POINT *const *, const UINT *, UINT, UINT * );
   BOOL cagdReusePolyline( UINT, const CAGD_POINT *, UINT );
   BOOL cagdGetVertex( UINT, UINT, CAGD_POINT * );
   BOOL cagdSetVertex( UINT, UINT, const CAGD_POINT * );
   UINT cagdGetNearestVertex( UINT, int, int );
+  UINT cagdGetNearestEdge( UINT, int, int );
+
+  /************************************************************************
+  * Mesh segment functions						*
+  ************************************************************************/
+  /************************************************************************
+  * DESCRIPTION:								M
+  *   Adds a polygonal mesh drawn as a wire frame. Faces index a shared	M
+  *   vertex array, so a vertex used by many faces is stored once.	M
+  *   cagdGetVertex, cagdSetVertex and cagdGetNearestVertex work on the	M
+  *   vertices of a mesh.							M
+  *									*
+  * PARAMETERS:								M
+  *   where	length vertices;					M
+  *   normals	length vertex normals (may be NULL);			M
+  *   length	number of vertices;					M
+  *   indices	vertices of all faces back to back;			M
+  *   faceSizes	number of vertices of each face;			M
+  *   nFaces	number of faces;					M
+  *									*
+  * RETURN VALUE:								M
+  *   ID of the new segment, 0 if an index is out of range;		M
+  ************************************************************************/
+  UINT cagdAddMesh( const CAGD_POINT *where,
+                    const CAGD_POINT *normals,
+                    UINT length,
+                    const UINT *indices,
+                    const UINT *faceSizes,
+                    UINT nFaces );
+  UINT cagdGetMeshFaceCount( UINT );
 
   /************************************************************************
   * Callback functions							*
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <memory_resource>
+
+// Pool of the selected scene (see scene.h) that curves and the vectors they
+// own are allocated from. Freed blocks are reused by the next curve instead
+// of going back to the heap, and an emptied scene is dropped with one release
+// instead of a free per vector. A curve remembers the pool it came from and
+// is freed into it, whichever scene is selected then.
+std::pmr::memory_resource *get_crv_resource();
+
+// Frees every block of the pool. Only valid when no curve is alive.
+void release_crv_resource();
+
+// Makes the calling thread allocate curves from p_res instead of the pool of
+// its scene, nullptr goes back to the pool. A worker that builds curves for
+// another thread's scene uses a thread safe resource such as
+// std::pmr::new_delete_resource(), the curves are freed into it later.
+void set_thread_crv_resource( std::pmr::memory_resource *p_res );
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Curve;
+class MappedFile;
+
+// .cagdb, the binary counterpart of the text curve format.
+//
+// A fixed header is followed by sections, each starting at a multiple of
+// K_CAGDB_ALIGN so a mapped file can be read in place. Values are little
+// endian.
+//
+//   dir     CagdbCurve[ num_crvs ]  where each curve's data starts
+//   orders  int32_t[ num_crvs ]
+//   flags   uint32_t[ num_crvs ]    K_CAGDB_* bits
+//   colors  uint8_t[ 4 * num_crvs ] red, green, blue, unused
+//   knots   double[]                all knot vectors back to back
+//   pnts    double[ 3 * ]           homogeneous x * w, y * w, w as in the
+//                                   text format
+//
+// In a K_CAGDB_PACKED file knots and pnts are encode_doubles streams instead,
+// their counts are in bytes.
+
+#define K_CAGDB_EXT ".cagdb"
+#define K_CAGDB_VERSION 1
+#define K_CAGDB_ALIGN 64
+
+enum
+{ /* file flags */
+  K_CAGDB_PACKED = 1
+};
+
+enum
+{ /* per curve flags */
+  K_CAGDB_BSPLINE = 1,
+  K_CAGDB_OPEN = 2,
+  K_CAGDB_UNI = 4
+};
+
+typedef struct
+{
+  uint64_t offset; // from the start of the file
+  uint64_t count;  // number of elements
+} CagdbSection;
+
+typedef struct
+{
+  char magic[ 8 ]; // "CAGDB" padded with zeros
+  uint32_t version;
+  uint32_t flags; // K_CAGDB_PACKED or 0
+  uint32_t num_crvs;
+  uint32_t header_size;
+  CagdbSection dir;
+  CagdbSection orders;
+  CagdbSection crv_flags;
+  CagdbSection colors;
+  CagdbSection knots;
+  CagdbSection pnts;
+} CagdbHeader;
+
+typedef struct
+{
+  uint64_t first_knot;
+  uint64_t first_pnt;
+  uint32_t num_knots;
+  uint32_t num_pnts;
+} CagdbCurve;
+
+// sections are shared with .cagds, see session.h
+void place_cagdb_section( CagdbSection &section,
+                          uint64_t &offset,
+                          uint64_t count,
+                          size_t elem_size );
+bool is_cagdb_section_valid( const CagdbSection &section,
+                             uint64_t file_size,
+                             size_t elem_size );
+
+bool is_binary_file_path( const std::string &file_path );
+
+// saves the curves of the selected scene, packed to within pack_tol if it is
+// positive
+bool save_binary_file( const std::string &file_path, double pack_tol = 0.0 );
+
+// adds the curves of the file to the selected scene, returns the index of
+// the first new curve like parse_file
+size_t load_binary_file( const std::string &file_path );
+
+// the sections of a mapped file, knots and pnts decoded if it is packed
+struct CagdbView
+{
+  const CagdbHeader *p_header;
+  const CagdbCurve *dir;
+  const int32_t *orders;
+  const uint32_t *flags;
+  const uint8_t *colors;
+  const double *knots;
+  const double *pnts; // homogeneous triples
+  uint64_t num_knots;
+  uint64_t num_pnts;
+  std::vector< double > unpacked_knots;
+  std::vector< double > unpacked_pnts;
+};
+
+bool get_cagdb_view( const MappedFile &file, CagdbView &view );
+bool is_cagdb_curve_valid( const CagdbView &view, uint32_t idx );
+Curve *build_cagdb_curve( const CagdbView &view, uint32_t idx );
+
+// a curve of K_CAGDB_* flags as stored in a .cagdb or .cagds file, a B-spline
+// has num_pnts + order knots (or more while it misses control points) and a
+// Bezier order control points
+bool is_cagdb_shape_valid( uint32_t flags, int32_t order, uint32_t num_knots, uint32_t num_pnts );
+
+// such a curve with its knots, the caller fills in the control points
+Curve *new_cagdb_curve( uint32_t flags, int32_t order, const double *knots, uint32_t num_knots );
+
+bool convert_text_to_binary( const std::string &text_path,
+                             const std::string &binary_path );
+
+bool convert_binary_to_text( const std::string &binary_path,
+                             const std::string &text_path );
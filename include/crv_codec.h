@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lossy packing of the smooth number streams curve files are made of.
+//
+// The values are read as stride interleaved channels, e.g. x, y, w of the
+// control points. Each value is rounded to a multiple of a power of two
+// quantum no bigger than 2 * tol, so it comes back within tol and values such
+// as 1 or 0.25 come back exactly. Each channel is predicted linearly from its
+// two previous values, the zig-zag varint residuals of a smooth polygon or a
+// near uniform knot vector are mostly single small bytes, and those bytes are
+// entropy coded with rANS.
+//
+// Returns false, leaving out untouched, if a value is not finite or too big
+// for tol.
+bool encode_doubles( const double *vals,
+                     size_t count,
+                     size_t stride,
+                     double tol,
+                     std::vector< uint8_t > &out );
+
+// Decodes a stream of encode_doubles, false if it is corrupt.
+bool decode_doubles( const uint8_t *begin,
+                     const uint8_t *end,
+                     std::vector< double > &vals );
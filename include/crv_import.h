@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+// Imports a text curve file with all cores. Independent stages connected by
+// bounded queues:
+//
+//   scan        one thread splits the mapped file into record texts
+//   parse       parses and validates records
+//   tessellate  builds each curve and samples it
+//   commit      the calling thread registers the curves all in one batch
+//
+// Curves keep the order of the file. Returns the index of the first new curve
+// in the selected scene, like parse_file.
+size_t import_file_parallel( const std::string &file_path );
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "Curve.h"
+
+// One curve as read from a text curve file, before it becomes a Curve.
+// Plain data, so it can be produced away from the UI thread.
+struct CurveRecord
+{
+  int order;
+  bool is_bspline;
+  bool is_open;
+  bool is_uni;
+  std::vector< double > knots;
+  std::vector< CAGD_POINT > pnts; // x, y already divided by the weight z
+};
+
+// Reads curve records from the text format in place, numbers are parsed with
+// std::from_chars. Bad curves, including ones with a zero weight or
+// decreasing knots, are skipped and counted.
+//
+// A scanning parser only counts the numbers instead of converting them, which
+// is enough to find where each record starts and ends; the knots and points
+// of its records are zeros.
+class CurveTextParser
+{
+public:
+  CurveTextParser( const char *begin, const char *end, bool is_scan = false );
+
+  bool next( CurveRecord &rec ); // false at the end of the text
+
+  // text of the record last returned by next
+  const char *record_begin() const { return rec_begin_; }
+  const char *record_end() const { return p_; }
+
+  const std::string &first_error() const { return first_error_; }
+  size_t num_errors() const { return num_errors_; }
+
+private:
+  void error( const char *message );
+  void read_numbers( const char *p, const char *end, std::vector< double > &vals );
+  void add_ctrl_pnts( const char *p, const char *end, CurveRecord &rec );
+  bool read_knots( const char *line_begin, const char *line_end, CurveRecord &rec );
+
+  const char *p_;
+  const char *end_;
+  const char *rec_begin_;
+  bool is_scan_;
+  std::vector< double > vals_; // scratch for the numbers of one line
+  std::string first_error_;
+  size_t num_errors_;
+};
+
+Curve *build_curve( const CurveRecord &rec );
+
+void report_parse_errors( const std::string &first_error, size_t num_errors );
+void print_load_stats( size_t num_crvs,
+                       size_t file_size,
+                       std::chrono::steady_clock::time_point start );
+
+// Loads a curve file through a read only mapping of it. Accepts the same
+// format as parse_file and registers the curves in the selected scene.
+// Returns the index of the first new curve in the scene, like parse_file.
+// Falls back to parse_file if the file cannot be mapped, hands big files to
+// import_file_parallel.
+size_t load_mapped_file( const std::string &file_path );
+
+// Loads a curve file into the shown scene without blocking the UI. A thread
+// parses the file and the curves are registered and drawn batch by batch on
+// the UI thread, from a timer of its own so the app's CAGD_TIMER callback is
+// left alone. Starting another load cancels the running one.
+void load_file_async( const std::string &file_path );
+void cancel_async_load();
+bool is_async_loading();
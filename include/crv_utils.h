@@ -1,8 +1,8 @@
 #pragma once
 
 #include <string>
-#include <map>
 #include <vector>
+#include "Curve.h"
 
 #define K_NOT_USED -1
 
@@ -13,19 +13,13 @@ class BSpline;
 typedef struct
 {
   int active_pt_id;
+  int active_pt_idx; // index in the picked point set
   int last_pos[2]; // in screen coordinates
   bool first_move;
 
 } active_ctrl_pt_data; // for lmb drag of ctrl pt
 
 
-enum class CurveType
-{
-  NONE = 0,
-  BEZIER = 1,
-  BSPLINE = 2
-};
-
 enum class ConnType
 {
   NONE = 0,
@@ -35,10 +29,17 @@ enum class ConnType
 };
 
 void save_all_curves( int seg_crv, int dummy2, void *p_data );
+bool save_text_file( const std::string &file_path );
 void save_curve( int seg_crv, int is_close, void *p_data );
 void load_curves( int dummy1, int dummy2, void *p_data );
 
 void register_crv( Curve *p_crv );
+void register_crvs( const std::vector< Curve * > &crvs );
+
+// like register_crvs for curves already sampled, crv_pnts[ i ] holds the
+// samples of crvs[ i ] (empty for none)
+void register_sampled_crvs( const std::vector< Curve * > &crvs,
+                            std::vector< point_vec > &crv_pnts );
 void free_crv( Curve *p_crv );
 void remove_crv_data( Curve *p_crv );
 void clean_all_curves();
@@ -47,25 +48,37 @@ void print_error( const std::string &message );
 void show_add_curve_help_text();
 
 void redraw_all_curves();
+
+// removes the knots every B-spline of the scene can do without within tol,
+// as one undoable operation. Returns the number of removed knots
+size_t reduce_all_knots( double tol );
+
+// Replaces p_crv by a B-spline of a lower order within tol of it, its spans
+// are halved until that fits. Undoable, returns the new curve or nullptr if
+// the order could not be lowered.
+BSpline *lower_crv_order( Curve *p_crv, int order, double tol );
 void hide_all_ctrl_polys();
 void show_all_ctrl_polys();
 
 void map_seg_to_crv( int seg_id, Curve *p_curve );
 void map_pnt_to_crv( int pnt_id, Curve *p_curve );
-void map_ctrl_seg_to_pnts( int seg_id, int pnt1, int pnt2 );
+void map_ctrl_seg_to_crv( int seg_id, Curve *p_curve );
 
 void erase_seg_to_crv( int seg_id );
 void erase_pnt_to_crv( int pnt_id );
-void erase_ctrl_seg_to_pnts( int pnt_id );
+void erase_ctrl_seg_to_crv( int seg_id );
 void erase_crv_from_cur_crvs( Curve *p_curve );
 
 Curve *get_pnt_crv( int pnt_id );
-std::tuple< int, int > get_ctrl_seg_pnts( int seg_id );
+Curve *get_ctrl_seg_crv( int seg_id );
 Curve *get_seg_crv( int seg_id );
 
 int get_active_pt_id();
 void set_active_pt_id( int id );
 
+int get_active_pt_idx();
+void set_active_pt_idx( int idx );
+
 int *get_active_pt_last_pos();
 void set_active_pt_last_pos( int pos[2] );
 
@@ -83,7 +96,7 @@ void add_knot_callback( int seg_id, double val );
 void rmv_knot_callback( int seg_id, int knot_idx );
 
 
-void update_ctrl_pnt_callback( int pnt_id, double new_x, double new_y );
+Curve *update_ctrl_pnt_callback( int pnt_id, int pnt_idx, double new_x, double new_y );
 bool connect_crv_callback( int seg_id_1, int seg_id_2, ConnType type );
 BSpline *createBSplineFromBezierCurves( Bezier *bezier1, Bezier *bezier2 );
 BSpline *createBSplineFromBSplines( BSpline *bspline1, BSpline *bspline2 );
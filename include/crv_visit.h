@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdexcept>
+#include "Bezier.h"
+#include "BSpline.h"
+
+// Calls func with p_crv cast to its concrete type, chosen by Curve::kind_.
+// func is usually a generic lambda or an overload set, so a new curve type
+// is one more case here instead of one more dynamic_cast at every call site.
+// func returns the same type for every curve type. The return type is deduced
+// from the body, so overload resolution between the const and non-const
+// versions does not call func with a pointer it was not meant for.
+template< typename Func >
+decltype( auto ) visit_crv( Curve *p_crv, Func &&func )
+{
+  switch( p_crv->kind_ )
+  {
+    case CurveType::BEZIER:
+      return func( static_cast< Bezier * >( p_crv ) );
+    case CurveType::BSPLINE:
+      return func( static_cast< BSpline * >( p_crv ) );
+    default:
+      throw std::runtime_error( "invalid crv type" );
+  }
+}
+
+template< typename Func >
+decltype( auto ) visit_crv( const Curve *p_crv, Func &&func )
+{
+  switch( p_crv->kind_ )
+  {
+    case CurveType::BEZIER:
+      return func( static_cast< const Bezier * >( p_crv ) );
+    case CurveType::BSPLINE:
+      return func( static_cast< const BSpline * >( p_crv ) );
+    default:
+      throw std::runtime_error( "invalid crv type" );
+  }
+}
+
+// Pairwise dispatch on both curves' concrete types.
+template< typename Crv1, typename Crv2, typename Func >
+decltype( auto ) visit_crv_pair( Crv1 *p_crv_1, Crv2 *p_crv_2, Func &&func )
+{
+  return visit_crv( p_crv_1, [ & ]( auto p_1 )
+                    {
+                      return visit_crv( p_crv_2, [ & ]( auto p_2 )
+                                        {
+                                          return func( p_1, p_2 );
+                                        } );
+                    } );
+}
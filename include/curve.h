@@ -3,6 +3,8 @@
 #include <sstream>
 #include <vector>
 #include "cagd.h"
+#include "slot_map.h"
+#include "crv_alloc.h"
 
 #define IS_DEBUG 1
 #define K_NOT_USED -1
@@ -11,6 +13,14 @@
 
 class Bezier;
 class BSpline;
+class TextBuffer;
+
+enum class CurveType
+{
+  NONE = 0,
+  BEZIER = 1,
+  BSPLINE = 2
+};
 
 enum class CtrlOp
 {
@@ -19,32 +29,47 @@ enum class CtrlOp
   RMV = 2
 };
 
-typedef std::vector< CAGD_POINT > point_vec;
-typedef std::vector< double > double_vec;
-typedef std::vector< int > int_vec;
+typedef std::pmr::vector< CAGD_POINT > point_vec;
+typedef std::pmr::vector< double > double_vec;
+typedef std::pmr::vector< int > int_vec;
 
 class Curve
 {
 public:
-  Curve();
-  Curve( int order_, point_vec ctrl_pnts_ );
+  Curve( CurveType kind );
+  Curve( CurveType kind, int order_, point_vec ctrl_pnts_ );
+  virtual ~Curve() {}
+
+  static void *operator new( size_t size );
+  static void operator delete( void *p_mem, size_t size );
 
-  virtual void dump( std::ofstream &ofs ) const;
-  void dumpOrder( std::ofstream &ofs ) const;
-  void dumpControlPoints( std::ofstream &ofs ) const;
-  void dumpPoint( std::ofstream &ofs, const CAGD_POINT &point ) const;
+  virtual void dump( TextBuffer &buf ) const;
+  void dumpOrder( TextBuffer &buf ) const;
+  void dumpControlPoints( TextBuffer &buf ) const;
+  void dumpPoint( TextBuffer &buf, const CAGD_POINT &point ) const;
 
   virtual bool show_crv( int chg_ctrl_idx = K_NOT_USED,
-                         CtrlOp op = CtrlOp::NONE ) const = 0;
+                         CtrlOp op = CtrlOp::NONE ) = 0;
 
-  virtual void show_ctrl_poly();
+  virtual bool sample_crv( point_vec &pnts ) const = 0;
+  virtual bool get_ctrl_poly_pnts( point_vec &pnts ) const;
+  void show_ctrl_poly();
 
   virtual bool is_miss_ctrl_pnts() const = 0;
+
+  // const members only read geometry, so any number of threads may evaluate
+  // and sample a curve at once as long as nobody edits it meanwhile
   virtual CAGD_POINT evaluate( double param ) const = 0;
+  virtual void update_eval_cache() {}
 
   virtual double get_dom_start() const { return 0.0; }
   virtual double get_dom_end() const { return 1.0; }
 
+  // Raises the degree by times keeping the exact shape. Lowers it by one if
+  // the curve moves at most tol, err receives how far it would move.
+  virtual bool elevateDegree( int times ) = 0;
+  virtual bool reduceDegree( double tol, double &err ) = 0;
+
   virtual void connectC0_bezier( const Bezier *other ) = 0;
   virtual void connectC1_bezier( const Bezier *other ) = 0;
   virtual void connectG1_bezier( const Bezier *other ) = 0;
@@ -60,16 +85,24 @@ public:
   virtual void print() const;
 
   void clean_ctrl_poly();
+  void clean_ctrl_pnts();
   void hide_ctrl_poly();
-  int get_pnt_id_idx( int pnt_id );
   void add_ctrl_pnt_from_str( std::istringstream &line );
   void update_weight( int pnt_idx, double val );
+  void move_ctrl_pnt( int pnt_idx, double new_x, double new_y );
   void change_color( BYTE red, BYTE green, BYTE blue );
 
+  // geometry
   int order_;
-  point_vec ctrl_pnts_;
-  mutable int_vec seg_ids_;
-  mutable int_vec pnt_ids_;
+  point_vec ctrl_pnts_{ get_crv_resource() };
+
+  // display state, only touched by show_* and clean_* on the main thread
+  int_vec seg_ids_{ get_crv_resource() };
+  int pnt_seg_id_;
+  int poly_seg_id_;
   GLubyte color_[ 3 ];
-  mutable int_vec poly_seg_ids_;
+
+  SlotHandle handle_; // in cur_curves
+  CurveType kind_; // concrete type, see crv_visit.h
+  unsigned int uid_; // stays the same when undo recreates the curve
 };
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Curve.h"
+
+// Undo/redo of curve edits.
+//
+// An operation calls hist_record on every curve it is about to change (or
+// create, or free) and hist_commit when it is done. Snapshots share their
+// control point and knot arrays with the previous snapshot of the same curve
+// unless the data actually changed, so an entry costs only what it changed.
+// Control point drags are kept as per point deltas instead of snapshots.
+// An operation that is a single knot or weight edit also calls
+// hist_record_edit, so the journal logs the edit and not the whole curve.
+// Every scene has a history of its own, see scene.h.
+
+struct HistState;
+
+enum class EditOp
+{
+  INSERT_KNOT = 1, // val is the knot
+  REMOVE_KNOT = 2, // idx is the knot index
+  SET_WEIGHT = 3   // idx is the control point index, val the weight
+};
+
+HistState *hist_create();
+void hist_destroy( HistState *p_hist );
+
+void hist_track( Curve *p_crv );
+void hist_untrack( Curve *p_crv );
+
+void hist_record( Curve *p_crv );
+void hist_record_drag( Curve *p_crv,
+                       int pnt_idx,
+                       const CAGD_POINT &from,
+                       const CAGD_POINT &to );
+void hist_record_edit( Curve *p_crv, EditOp op, int idx, double val );
+void hist_commit();
+
+bool hist_undo();
+bool hist_redo();
+void hist_clear(); // drops the history and the tracked curves with it
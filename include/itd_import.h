@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+
+#define K_ITD_EXT ".itd"
+
+bool is_itd_file_path( const std::string &file_path );
+
+// Loads the polygons of an IRIT data file, one CAGD_SEGMENT_MESH per object.
+// The file is read in place through a mapping and each object becomes a mesh
+// as soon as it is closed. Vertices shared by several polygons are stored
+// once. Other IRIT objects (curves, surfaces, attributes) are skipped.
+// Returns the number of meshes added to the selected segment table.
+size_t import_itd_file( const std::string &file_path );
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include "Curve.h"
+#include "history.h"
+
+#define K_AUTOSAVE_PATH "cagd_autosave"
+
+// Crash safe autosave of a scene as an append only journal of its edits.
+//
+//   <base>.jrnl          records, each with its size and a checksum
+//   <base>.<gen>.cagdb   the snapshot the journal starts from
+//
+// The journal starts with the generation of its snapshot and the uids of the
+// snapshot's curves. Every committed edit, undo and redo appends the new state
+// of the curves it changed (or their removal, or the moved control points, or
+// the knot or weight edit itself), so autosave costs what was edited, not the
+// size of the scene. Records are written and synced in batches, at the latest
+// a second after the first of them, a crash loses at most the last batch. Once
+// the journal outgrows its snapshot it is compacted into a new snapshot and an
+// empty journal.
+//
+// journal_open replays an existing journal on top of its snapshot into the
+// selected scene and then journals that scene. A torn record at the end of
+// the journal, from a crash in the middle of a write, ends the replay.
+bool journal_open( const std::string &base_path );
+void journal_close(); // syncs what is left
+bool journal_is_open();
+void journal_compact();
+
+// called by the edit paths, ignored unless the selected scene is journaled
+void journal_put_crv( const Curve *p_crv );
+void journal_put_removed( unsigned int uid );
+void journal_put_drag( unsigned int uid, int pnt_idx, const CAGD_POINT &pos );
+void journal_put_edit( unsigned int uid, EditOp op, int idx, double val );
+void journal_put_clear();
+void journal_end_op();
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include "cagd.h"
+
+// read only view of a whole file
+class MappedFile
+{
+public:
+  MappedFile( const std::string &file_path ) :
+    file_( INVALID_HANDLE_VALUE ),
+    mapping_( NULL ),
+    data_( nullptr ),
+    size_( 0 )
+  {
+    file_ = CreateFileA( file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                         OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+
+    if( file_ == INVALID_HANDLE_VALUE )
+      return;
+
+    LARGE_INTEGER size;
+
+    // an empty file cannot be mapped, it is simply empty
+    if( !GetFileSizeEx( file_, &size ) || size.QuadPart == 0 )
+      return;
+
+    mapping_ = CreateFileMappingA( file_, NULL, PAGE_READONLY, 0, 0, NULL );
+
+    if( mapping_ == NULL )
+      return;
+
+    data_ = ( const char * )MapViewOfFile( mapping_, FILE_MAP_READ, 0, 0, 0 );
+
+    if( data_ != nullptr )
+      size_ = ( size_t )size.QuadPart;
+  }
+
+  ~MappedFile()
+  {
+    if( data_ != nullptr )
+      UnmapViewOfFile( data_ );
+
+    if( mapping_ != NULL )
+      CloseHandle( mapping_ );
+
+    if( file_ != INVALID_HANDLE_VALUE )
+      CloseHandle( file_ );
+  }
+
+  MappedFile( const MappedFile & ) = delete;
+  MappedFile &operator=( const MappedFile & ) = delete;
+
+  bool is_open() const { return file_ != INVALID_HANDLE_VALUE; }
+  bool is_mapped() const { return data_ != nullptr; }
+  const char *begin() const { return data_; }
+  const char *end() const { return data_ + size_; }
+  size_t size() const { return size_; }
+
+private:
+  HANDLE file_;
+  HANDLE mapping_;
+  const char *data_;
+  size_t size_;
+};
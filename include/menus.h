@@ -26,9 +26,15 @@ void handle_rmb_open_knots();
 void handle_rmb_uni_knots();
 void handle_rmb_mod_knots();
 void handle_rmb_add_knot_menu();
+void handle_rmb_reduce_knots();
+void handle_rmb_elevate_degree();
+void handle_rmb_reduce_degree();
 void handle_settings_menu();
 void handle_clean_all_menu();
 void handle_hide_ctrl_polys_menu();
+void handle_pack_saves_menu();
+void handle_autosave_menu();
+void handle_tess_cache_menu();
 void handle_add_curve_menu();
 void handle_curve_color_menu();
 void handle_rmb_remove_curve();
@@ -37,6 +43,8 @@ void handle_rmb_insert_ctrl_pt();
 void handle_rmb_prepend_ctrl_pt();
 void handle_rmb_append_ctrl_pt();
 void handle_change_weight_menu();
+void handle_undo_menu();
+void handle_redo_menu();
 void handle_rmb_connect_c0();
 void handle_rmb_connect_c1();
 void handle_rmb_connect_g1();
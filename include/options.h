@@ -1,6 +1,8 @@
 #pragma once
 
 #define NUM_SAMPS 2000
+#define DEF_PACK_TOL 1e-6
+#define DEF_REDUCE_TOL 1e-4 // how far knot removal may move a curve
 
 const unsigned char *get_curve_color();
 void set_curve_color( unsigned char new_curve_color[ 3 ] );
@@ -12,3 +14,9 @@ void set_default_num_steps( unsigned int val );
 
 void set_hide_ctrl_polys( bool hide );
 bool get_hide_ctrl_polys();
+
+// binary files are saved packed to within the tolerance when enabled
+void set_pack_saves( bool pack );
+bool get_pack_saves();
+void set_pack_tol( double tol );
+double get_pack_tol();
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+#define K_PAGED_MIN_FILE_SIZE ( 256ull << 20 ) // smaller files are loaded whole
+#define K_PAGED_BUDGET ( 4u << 20 ) // control points and samples kept resident
+#define K_PAGED_GRID_DIM 256 // cells along each side of the spatial index
+#define K_PAGED_MAX_CELLS 64 // curves covering more cells are tested one by one
+
+// Browsing of .cagdb files larger than memory.
+//
+// The file stays mapped and only the curves whose bounding boxes meet the
+// view are built and drawn, together at most K_PAGED_BUDGET control points
+// and samples. The boxes are indexed by a uniform grid over the whole file.
+// Each time the view changes (CAGD_VIEWCHANGE) the curves in view are paged
+// in and, when the budget is exceeded, the least recently seen curves out of
+// view are evicted from the scene.
+//
+// Paged curves are added to the selected scene like loaded ones. A curve that
+// was edited is no longer evicted, one that was removed is not paged in
+// again. Saving writes what is resident, not the whole file. Packed files
+// cannot be paged, and paging does not go along with autosave.
+bool is_paged_file_path( const std::string &file_path );
+bool paged_scene_open( const std::string &file_path );
+void paged_scene_close(); // evicts what was not edited
+bool paged_scene_is_open(); // for the selected scene
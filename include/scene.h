@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+#include "cagd.h"
+#include "slot_map.h"
+
+class Curve;
+struct HistState;
+
+struct SceneOptions
+{
+  unsigned int num_steps;
+  unsigned int def_degree;
+  unsigned char curve_color[ 3 ];
+  bool hide_ctrl_polys;
+  bool pack_saves;
+  double pack_tol;
+};
+
+// One independent set of curves with everything that refers to them: the
+// segment table they are drawn in, the id to curve tables, the settings, the
+// pool they are allocated from and their undo history.
+//
+// crv_utils, options and history work on the scene selected by the calling
+// thread. Every thread starts with the default scene, which is the one shown
+// in the window, so a batch tool can load one file per thread by creating a
+// scene, selecting it and destroying it when done.
+struct Scene
+{
+  Scene();
+  ~Scene();
+
+  SlotMap< Curve * > curves;
+
+  // segment ids are small dense integers, so each table is indexed by id
+  std::vector< Curve * > seg_to_crv;
+  std::vector< Curve * > pnt_to_crv;
+  std::vector< Curve * > ctrl_seg_to_crv;
+
+  SceneOptions opts;
+  std::pmr::unsynchronized_pool_resource pool;
+  HistState *hist;
+  CAGD_SEG_TABLE *segs; // nullptr for the default table
+};
+
+Scene *scene_create();
+void scene_destroy( Scene *p_scene );
+Scene *scene_select( Scene *p_scene ); // nullptr selects the default scene
+Scene *get_scene();
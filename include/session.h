@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "cagd.h"
+#include "crv_binary.h"
+
+// .cagds, a whole working session: the curves, their tessellated polylines
+// and segment state, the options and the view. Laid out like .cagdb, a fixed
+// header and K_CAGDB_ALIGN aligned sections read in place from a mapping, so
+// reopening a session copies the polylines into the segment table instead of
+// parsing and sampling the curves again.
+//
+//   dir      SessionCurve[ num_crvs ]
+//   knots    double[]
+//   pnts     CAGD_POINT[]  control points as stored by the curves
+//   samples  CAGD_POINT[]  the drawn polyline of each curve
+
+#define K_SESSION_EXT ".cagds"
+#define K_SESSION_VERSION 1
+
+enum
+{ /* per curve flags besides K_CAGDB_BSPLINE, K_CAGDB_OPEN and K_CAGDB_UNI */
+  K_SESSION_CRV_HIDDEN = 0x100,
+  K_SESSION_POLY_HIDDEN = 0x200
+};
+
+typedef struct
+{
+  char magic[ 8 ]; // "CAGDS" padded with zeros
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t num_crvs;
+  uint32_t num_steps;
+  uint32_t def_degree;
+  uint8_t curve_color[ 4 ];
+  uint8_t hide_ctrl_polys;
+  uint8_t pack_saves;
+  uint16_t view;
+  int32_t cue;
+  int32_t fuzziness;
+  double pack_tol;
+  double sensitive;
+  double model_view[ 16 ];
+  CagdbSection dir;
+  CagdbSection knots;
+  CagdbSection pnts;
+  CagdbSection samples;
+} SessionHeader;
+
+typedef struct
+{
+  uint64_t first_knot;
+  uint64_t first_pnt;
+  uint64_t first_sample;
+  uint32_t num_knots;
+  uint32_t num_pnts;
+  uint32_t num_samples;
+  int32_t order;
+  uint32_t flags;
+  uint8_t color[ 4 ];
+} SessionCurve;
+
+bool is_session_file_path( const std::string &file_path );
+
+// saves the selected scene and the view
+bool save_session( const std::string &file_path );
+
+// replaces the curves and options of the selected scene and the view
+bool load_session( const std::string &file_path );
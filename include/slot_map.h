@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+
+// Stable reference into a SlotMap. A handle whose slot was erased (and maybe
+// reused since) has a stale generation and no longer resolves.
+struct SlotHandle
+{
+  unsigned int idx;
+  unsigned int gen; // 0 is never a live generation
+};
+
+const SlotHandle K_NO_HANDLE = { 0, 0 };
+
+// Generational slot map: O(1) insert, erase and lookup by handle, values kept
+// dense so iteration touches only live entries. Erase moves the last value
+// into the hole, so iteration order is not insertion order.
+template< typename T >
+class SlotMap
+{
+public:
+  typedef typename std::vector< T >::iterator iterator;
+  typedef typename std::vector< T >::const_iterator const_iterator;
+
+  SlotHandle insert( const T &value )
+  {
+    unsigned int slot_idx;
+
+    if( free_slots_.empty() )
+    {
+      slot_idx = ( unsigned int )slots_.size();
+      slots_.push_back( { 0, 1 } );
+    }
+    else
+    {
+      slot_idx = free_slots_.back();
+      free_slots_.pop_back();
+    }
+
+    slots_[ slot_idx ].dense_idx = ( unsigned int )values_.size();
+    values_.push_back( value );
+    dense_to_slot_.push_back( slot_idx );
+
+    return { slot_idx, slots_[ slot_idx ].gen };
+  }
+
+  bool erase( SlotHandle handle )
+  {
+    if( !contains( handle ) )
+      return false;
+
+    Slot &slot = slots_[ handle.idx ];
+    unsigned int last = ( unsigned int )values_.size() - 1;
+
+    if( slot.dense_idx != last )
+    {
+      values_[ slot.dense_idx ] = values_[ last ];
+      dense_to_slot_[ slot.dense_idx ] = dense_to_slot_[ last ];
+      slots_[ dense_to_slot_[ last ] ].dense_idx = slot.dense_idx;
+    }
+
+    values_.pop_back();
+    dense_to_slot_.pop_back();
+
+    if( ++slot.gen == 0 )
+      slot.gen = 1;
+
+    free_slots_.push_back( handle.idx );
+    return true;
+  }
+
+  bool contains( SlotHandle handle ) const
+  {
+    return handle.gen != 0 &&
+           handle.idx < slots_.size() &&
+           slots_[ handle.idx ].gen == handle.gen;
+  }
+
+  T *get( SlotHandle handle )
+  {
+    return contains( handle ) ? &values_[ slots_[ handle.idx ].dense_idx ] : nullptr;
+  }
+
+  void reserve( size_t num )
+  {
+    values_.reserve( num );
+    dense_to_slot_.reserve( num );
+    slots_.reserve( num );
+  }
+
+  // drops all values, outstanding handles become stale
+  void clear()
+  {
+    for( size_t i = 0; i < dense_to_slot_.size(); ++i )
+    {
+      Slot &slot = slots_[ dense_to_slot_[ i ] ];
+
+      if( ++slot.gen == 0 )
+        slot.gen = 1;
+
+      free_slots_.push_back( dense_to_slot_[ i ] );
+    }
+
+    values_.clear();
+    dense_to_slot_.clear();
+  }
+
+  size_t size() const { return values_.size(); }
+  bool empty() const { return values_.empty(); }
+
+  T &operator[]( size_t dense_idx ) { return values_[ dense_idx ]; }
+  const T &operator[]( size_t dense_idx ) const { return values_[ dense_idx ]; }
+
+  iterator begin() { return values_.begin(); }
+  iterator end() { return values_.end(); }
+  const_iterator begin() const { return values_.begin(); }
+  const_iterator end() const { return values_.end(); }
+
+private:
+  struct Slot
+  {
+    unsigned int dense_idx;
+    unsigned int gen;
+  };
+
+  std::vector< T > values_;
+  std::vector< unsigned int > dense_to_slot_;
+  std::vector< Slot > slots_;
+  std::vector< unsigned int > free_slots_;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include "Curve.h"
+
+#define K_TESS_CACHE_PATH "cagd_tess.cache"
+
+// Persistent cache of curve polylines, so reopening the same curve files does
+// not sample the same curves again.
+//
+// A polyline is keyed by a 64 bit hash of the curve's type, order, knots,
+// control points (with their weights) and the number of samples. The order and
+// the number of control points and knots are kept as well and must match on a
+// lookup. The file is a header followed by appended records:
+//
+//   [key u64][order i32][num pnts u32][num knots u32][num samples u32]
+//   [checksum u32][unused u32][CAGD_POINT * num samples]
+//
+// The keys and file offsets of the records are indexed in memory when the
+// cache is opened, a lookup reads just its record. A torn record at the end
+// of the file ends the index and is written over. The file stops growing at
+// K_TESS_CACHE_MAX_SIZE.
+//
+// All functions may be called from any thread, and do nothing while the cache
+// is closed.
+bool tess_cache_open( const std::string &file_path );
+void tess_cache_close();
+bool tess_cache_is_open();
+
+// the cached polyline of the curve, false on a miss
+bool tess_cache_find( const Curve *p_crv, point_vec &pnts );
+
+// samples the curve on a miss and adds the result to the cache. Used by the
+// loaders; interactive edits only look up, their intermediate shapes are not
+// worth keeping
+bool tess_cache_sample( const Curve *p_crv, point_vec &pnts );
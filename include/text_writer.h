@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class Curve;
+
+// Growable character buffer the curves format themselves into. Numbers are
+// written with std::to_chars, which gives the shortest text that reads back
+// to the same double.
+class TextBuffer
+{
+public:
+  void put( char c ) { buf_.push_back( c ); }
+  void put( const char *str );
+  void put_int( long long val );
+  void put_double( double val );
+
+  const char *data() const { return buf_.data(); }
+  size_t size() const { return buf_.size(); }
+  void clear() { buf_.clear(); }
+  void reserve( size_t size ) { buf_.reserve( size ); }
+
+private:
+  std::vector< char > buf_;
+};
+
+// Writes curves in the text format. The curves are formatted chunk by chunk,
+// on several threads when there are enough control points, and every chunk
+// goes to the file with a single write.
+bool write_crvs_text( const std::string &file_path,
+                      const std::vector< const Curve * > &crvs );
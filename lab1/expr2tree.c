@@ -86,7 +86,7 @@
 int    e2t_parsing_error;                   /* Globals used by the parser */
 static int glbl_token, glbl_last_token;
 static int glbl_deriv_error;                 /* Globals used by derivations */
-static double GlobalParam[ E2T_PARAM_Z1 ];     /* The parameters are save here */
+static __declspec( thread ) double GlobalParam[ E2T_PARAM_Z1 ];     /* The parameters are save here */
 
 static e2t_expr_node *e2t_malloc( unsigned size );
 static void e2t_free( e2t_expr_node *Ptr );
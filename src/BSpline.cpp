@@ -10,11 +10,14 @@
 #include <string>
 #include <fstream>
 #include <iostream>
-#include <iomanip>
 
 #include "BSpline.h"
 #include "Bezier.h"
+#include "tess_cache.h"
 #include "crv_utils.h"
+#include "text_writer.h"
+
+#define K_ROUND_OFF_TOL 1e-9 // relative, for knot removals that must be exact
 
 /******************************************************************************
 * BSpline::insertKnot
@@ -23,98 +26,148 @@ void BSpline::insertKnot( double knot_to_insert )
 {
   int num_ctrl_points = ctrl_pnts_.size();
   int degree = order_ - 1;
-  int num_knots = knots_.size();
 
   if( knot_to_insert < knots_[ degree ] ||
-      knot_to_insert > knots_[ num_ctrl_points + 1 ] )
+      knot_to_insert > knots_[ num_ctrl_points ] )
   {
     print_error( "Invalid knot value: " + std::to_string( knot_to_insert ) +
                  ". It must be within the range [" + std::to_string( knots_[ degree ] ) +
-                 ", " + std::to_string( knots_[ num_ctrl_points + 1 ] ) + "]." );
+                 ", " + std::to_string( knots_[ num_ctrl_points ] ) + "]." );
     return;
   }
 
-  int knot_span = -1;
+  refineKnotVector( double_vec( 1, knot_to_insert ) );
+}
+
+/******************************************************************************
+* BSpline::refineKnotVector
+******************************************************************************/
+// Boehm's refinement of all knots at once (The NURBS Book, A5.4), on the
+// homogeneous control points x * w, y * w, w
+bool BSpline::refineKnotVector( const double_vec &new_knots )
+{
+  int n = ( int )ctrl_pnts_.size() - 1;
+  int p = order_ - 1;
+  int m = n + p + 1;
+  int r = ( int )new_knots.size() - 1;
+
+  if( r < 0 )
+    return true;
 
-  for( int i = 0; i < num_knots - 1; ++i )
+  if( n < p || knots_.size() != ctrl_pnts_.size() + order_ )
   {
-    if( knot_to_insert >= knots_[ i ] && knot_to_insert < knots_[ i + 1 ] )
-    {
-      knot_span = i;
-      break;
-    }
+    print_error( "Please make sure the number of knots is\n"
+                 "the number of control points plus the order." );
+    return false;
   }
 
-  if( knot_span == -1 )
+  for( int j = 0; j <= r; ++j )
   {
-    print_error( "Invalid knot value." );
-    return;
+    if( new_knots[ j ] < knots_[ p ] || new_knots[ j ] > knots_[ n + 1 ] ||
+        ( j > 0 && new_knots[ j ] < new_knots[ j - 1 ] ) )
+    {
+      print_error( "Knots to insert must be sorted and within the domain." );
+      return false;
+    }
   }
 
-  std::vector<CAGD_POINT> new_ctrl_pnts( num_ctrl_points + 1 );
+  int a = findKnotSpan( new_knots[ 0 ] );
+  int b = findKnotSpan( new_knots[ r ] ) + 1;
 
-  for( int i = 0; i <= max( 0, knot_span - degree ); ++i )
-    new_ctrl_pnts[ i ] = ctrl_pnts_[ i ];
+  // the refined points and knots are built once, in the curve's pool
+  point_vec pw( ctrl_pnts_.size() + r + 1, ctrl_pnts_.get_allocator() );
+  double_vec refined( knots_.size() + r + 1, knots_.get_allocator() );
 
-  for( int i = max( 1, knot_span - degree + 1 ); i <= knot_span; ++i )
+  auto to_hom = [ this ]( int i )
   {
-    double denominator = knots_[ i + degree + 1 ] - knots_[ i ];
+    const CAGD_POINT &pnt = ctrl_pnts_[ i ];
+    CAGD_POINT hom = { pnt.x * pnt.z, pnt.y * pnt.z, pnt.z };
+    return hom;
+  };
 
-    if( denominator == 0 )
-    {
-      print_error( "Division by zero error: knot span contains repeated values." );
-      return;
-    }
+  for( int j = 0; j <= a - p; ++j )
+    pw[ j ] = to_hom( j );
 
-    double alpha = ( knot_to_insert - knots_[ i ] ) / denominator;
+  for( int j = b - 1; j <= n; ++j )
+    pw[ j + r + 1 ] = to_hom( j );
 
-    const CAGD_POINT &pnt1 = ctrl_pnts_[ i ];
-    const CAGD_POINT &pnt2 = ctrl_pnts_[ i - 1 ];
+  for( int j = 0; j <= a; ++j )
+    refined[ j ] = knots_[ j ];
 
-    double x1 = pnt1.x * pnt1.z;
-    double y1 = pnt1.y * pnt1.z;
-    double x2 = pnt2.x * pnt2.z;
-    double y2 = pnt2.y * pnt2.z;
+  for( int j = b + p; j <= m; ++j )
+    refined[ j + r + 1 ] = knots_[ j ];
 
-    new_ctrl_pnts[ i ].x = alpha * x1 + ( 1.0 - alpha ) * x2;
-    new_ctrl_pnts[ i ].y = alpha * y1 + ( 1.0 - alpha ) * y2;
+  int i = b + p - 1;
+  int k = b + p + r;
 
-    new_ctrl_pnts[ i ].z = 1.0;
-  }
+  for( int j = r; j >= 0; --j )
+  {
+    while( new_knots[ j ] <= knots_[ i ] && i > a )
+    {
+      pw[ k - p - 1 ] = to_hom( i - p - 1 );
+      refined[ k ] = knots_[ i ];
+      --k;
+      --i;
+    }
 
-  for( int i = knot_span + 1; i < num_ctrl_points + 1; ++i )
-    new_ctrl_pnts[ i ] = ctrl_pnts_[ i - 1 ];
+    pw[ k - p - 1 ] = pw[ k - p ];
 
-  std::vector< double > new_knots( num_knots + 1 );
+    for( int l = 1; l <= p; ++l )
+    {
+      int ind = k - p + l;
+      double alpha = refined[ k + l ] - new_knots[ j ];
 
-  for( int i = 0; i <= knot_span; ++i )
-    new_knots[ i ] = knots_[ i ];
+      if( alpha == 0.0 )
+        pw[ ind - 1 ] = pw[ ind ];
+      else
+      {
+        alpha /= refined[ k + l ] - knots_[ i - p + l ];
+
+        CAGD_POINT &pnt = pw[ ind - 1 ];
+        const CAGD_POINT &next = pw[ ind ];
+
+        pnt.x = alpha * pnt.x + ( 1.0 - alpha ) * next.x;
+        pnt.y = alpha * pnt.y + ( 1.0 - alpha ) * next.y;
+        pnt.z = alpha * pnt.z + ( 1.0 - alpha ) * next.z;
+      }
+    }
+
+    refined[ k ] = new_knots[ j ];
+    --k;
+  }
 
-  new_knots[ knot_span + 1 ] = knot_to_insert;
+  for( auto &pnt : pw )
+  {
+    if( pnt.z != 0.0 )
+    {
+      pnt.x /= pnt.z;
+      pnt.y /= pnt.z;
+    }
+  }
 
-  for( int i = knot_span + 1; i < num_knots; ++i )
-    new_knots[ i + 1 ] = knots_[ i ];
+  ctrl_pnts_.swap( pw );
+  knots_.swap( refined );
+  updateUniqueKnotsAndMultiplicity();
 
-  ctrl_pnts_ = new_ctrl_pnts;
-  knots_ = new_knots;
+  return true;
 }
 
 /******************************************************************************
 * BSpline::dump
 ******************************************************************************/
-void BSpline::dump( std::ofstream &ofs ) const
+void BSpline::dump( TextBuffer &buf ) const
 {
-  dumpOrder( ofs );
-  dumpKnots( ofs );
-  dumpControlPoints( ofs );
+  dumpOrder( buf );
+  dumpKnots( buf );
+  dumpControlPoints( buf );
 }
 
 /******************************************************************************
 * BSpline::dumpKnots
 ******************************************************************************/
-void BSpline::dumpKnots( std::ofstream &ofs ) const
+void BSpline::dumpKnots( TextBuffer &buf ) const
 {
-  std::string prefix = "knots[";
+  const char *prefix = "knots[";
   if( is_open_ && is_uni_ )
   {
     prefix = "uni_open_knots[";
@@ -128,16 +181,19 @@ void BSpline::dumpKnots( std::ofstream &ofs ) const
     prefix = "uni_knots[";
   }
 
-  ofs << prefix << knots_.size() << "] = ";
+  buf.put( prefix );
+  buf.put_int( ( long long )knots_.size() );
+  buf.put( "] = " );
   for( size_t i = 0; i < knots_.size(); ++i )
   {
     if( i > 0 && i % 6 == 0 )
     {
-      ofs << "\n\t";
+      buf.put( "\n\t" );
     }
-    ofs << std::fixed << std::setprecision( 6 ) << knots_[ i ] << " ";
+    buf.put_double( knots_[ i ] );
+    buf.put( ' ' );
   }
-  ofs << "\n";
+  buf.put( '\n' );
 }
 
 /******************************************************************************
@@ -193,7 +249,7 @@ bool BSpline::parseKnotsDescription( const std::string &description )
   std::vector<std::string> prefixes = { "knots[", "open_knots[", "uni_knots[", "uni_open_knots[", "open_uni_knots[" };
 
   // Temporary vector to hold the new knots
-  std::vector<double> new_knots;
+  double_vec new_knots;
   std::string foundPrefix;
 
   // Parse the number of knots
@@ -398,7 +454,9 @@ void BSpline::adjustForContinuity( const BSpline *other, bool isG1 )
 {
   connectC0_bspline( other );
 
-  order_ = other->order_;
+  // the lower order curve is raised, its shape stays the same
+  if( order_ < other->order_ )
+    elevateDegree( other->order_ - order_ );
 
   CAGD_POINT lastCtrlPoint = other->ctrl_pnts_.front();
 
@@ -577,18 +635,20 @@ void BSpline::makeOpenKnotVector()
 }
 
 /******************************************************************************
-* BSpline::show_ctrl_poly
+* BSpline::get_ctrl_poly_pnts
 ******************************************************************************/
-void BSpline::show_ctrl_poly()
+bool BSpline::get_ctrl_poly_pnts( point_vec &pnts ) const
 {
-  if( knots_.size() == ctrl_pnts_.size() + order_ )
-    Curve::show_ctrl_poly();
+  if( knots_.size() != ctrl_pnts_.size() + order_ )
+    return false;
+
+  return Curve::get_ctrl_poly_pnts( pnts );
 }
 
 /******************************************************************************
 * BSpline::show_crv
 ******************************************************************************/
-bool BSpline::show_crv( int chg_ctrl_idx, CtrlOp op ) const
+bool BSpline::show_crv( int chg_ctrl_idx, CtrlOp )
 {
   if( ctrl_pnts_.size() < ( size_t )order_ || knots_.size() != ctrl_pnts_.size() + order_ )
     return false;
@@ -607,35 +667,46 @@ bool BSpline::show_crv( int chg_ctrl_idx, CtrlOp op ) const
 
     show_crv_helper( u_vec_idxs );*/
 
-    size_t num_steps = get_default_num_steps();
-    auto pnts = new CAGD_POINT[ num_steps ];
+    point_vec pnts;
 
-    if( pnts != NULL )
+    if( !tess_cache_find( this, pnts ) )
+      sample_crv( pnts );
+
+    cagdSetColor( color_[ 0 ], color_[ 1 ], color_[ 2 ] );
+
+    if( seg_ids_.size() > 0 )
+      cagdReusePolyline( seg_ids_[ 0 ], pnts.data(), pnts.size() );
+    else
     {
-      double min_val = get_dom_start();
-      double max_val = get_dom_end();
-      double delta = max_val - min_val;
-      double jump = 1.0 / ( double )( num_steps - 1 );
+      int seg_id = cagdAddPolyline( pnts.data(), pnts.size() );
+      seg_ids_.push_back( seg_id );
+      map_seg_to_crv( seg_id, this );
+    }
+  }
 
-      cagdSetColor( color_[ 0 ], color_[ 1 ], color_[ 2 ] );
+  return true;
+}
 
-      for( size_t i = 0; i < num_steps; ++i )
-      {
-        double param = min_val + delta * jump * i;
-        pnts[ i ] = evaluate( param );
-      }
+/******************************************************************************
+* BSpline::sample_crv
+******************************************************************************/
+bool BSpline::sample_crv( point_vec &pnts ) const
+{
+  if( ctrl_pnts_.size() < ( size_t )order_ || knots_.size() != ctrl_pnts_.size() + order_ )
+    return false;
 
-      if( seg_ids_.size() > 0 )
-        cagdReusePolyline( seg_ids_[ 0 ], pnts, num_steps );
-      else
-      {
-        int seg_id = cagdAddPolyline( pnts, num_steps );
-        seg_ids_.push_back( seg_id );
-        map_seg_to_crv( seg_id, ( Curve * )this );
-      }
+  size_t num_steps = get_default_num_steps();
+  double min_val = get_dom_start();
+  double max_val = get_dom_end();
+  double delta = max_val - min_val;
+  double jump = 1.0 / ( double )( num_steps - 1 );
 
-      delete[] pnts;
-    }
+  pnts.resize( num_steps );
+
+  for( size_t i = 0; i < num_steps; ++i )
+  {
+    double param = min_val + delta * jump * i;
+    pnts[ i ] = evaluate( param );
   }
 
   return true;
@@ -644,7 +715,7 @@ bool BSpline::show_crv( int chg_ctrl_idx, CtrlOp op ) const
 /******************************************************************************
 * BSpline::show_crv_helper
 ******************************************************************************/
-void BSpline::show_crv_helper( std::vector< int > u_vec_idxs ) const
+void BSpline::show_crv_helper( std::vector< int > u_vec_idxs )
 {
   double normalized_num_samps = get_default_num_steps() /
                                 u_vec_[ u_vec_.size() - 1 ];
@@ -684,7 +755,7 @@ void BSpline::show_crv_helper( std::vector< int > u_vec_idxs ) const
       {
         int seg_id = cagdAddPolyline( pnts, num_samps );
         seg_ids_.push_back( seg_id );
-        map_seg_to_crv( seg_id, ( Curve * )this );
+        map_seg_to_crv( seg_id, this );
       }
     }
 
@@ -893,82 +964,487 @@ void BSpline::updateUniqueKnotsAndMultiplicity()
 ******************************************************************************/
 void BSpline::addKnot( double new_knot )
 {
-  auto it = std::lower_bound( knots_.begin(), knots_.end(), new_knot );
-  int insert_pos = it - knots_.begin();
-  knots_.insert( it, new_knot );
+  refineKnotVector( double_vec( 1, new_knot ) );
+}
+
+/******************************************************************************
+* BSpline::updateKnot
+******************************************************************************/
+void BSpline::updateKnot( int knot_idx, double new_param )
+{
+  if( ( size_t )knot_idx >= knots_.size() )
+    throw std::runtime_error( "wrong knot idx" );
+
+  knots_[ knot_idx ] = new_param;
   ensureNonDecreasingKnotVector();
   updateUniqueKnotsAndMultiplicity();
+}
+
+/******************************************************************************
+* BSpline::rmvKnot
+******************************************************************************/
+void BSpline::rmvKnot( int knot_idx )
+{
+  if( ( size_t )knot_idx >= knots_.size() )
+    throw std::runtime_error( "wrong knot idx" );
+
+  int n = ( int )ctrl_pnts_.size() - 1;
+  int p = order_ - 1;
+  double knot = knots_[ knot_idx ];
+  double err;
+
+  // an interior knot is removed keeping the curve as close as possible
+  if( knot > knots_[ p ] && knot < knots_[ n + 1 ] )
+  {
+    if( removeKnot( knot, 1, HUGE_VAL, err ) == 0 )
+      print_error( "The knot cannot be removed." );
+
+    return;
+  }
+
+  // an end knot goes with the end control point, the domain shrinks
+  knots_.erase( knots_.begin() + knot_idx );
+
+  if( knot_idx <= p )
+    ctrl_pnts_.erase( ctrl_pnts_.begin() );
+  else
+    ctrl_pnts_.pop_back();
+
+  updateUniqueKnotsAndMultiplicity();
+}
 
-  point_vec new_ctrl_pnts;
+/******************************************************************************
+* BSpline::removeKnot
+******************************************************************************/
+// Tiller's knot removal (The NURBS Book, A5.8) on the homogeneous control
+// points. Each removal is checked against what is left of tol, so err is a
+// bound on how far the curve moved in all
+int BSpline::removeKnot( double u, int num, double tol, double &err )
+{
+  int n = ( int )ctrl_pnts_.size() - 1;
   int p = order_ - 1;
+  int m = n + p + 1;
+  int ord = p + 1;
+
+  err = 0.0;
+
+  if( n < p || knots_.size() != ctrl_pnts_.size() + order_ ||
+      !( u > knots_[ p ] && u < knots_[ n + 1 ] ) )
+    return 0;
+
+  // r is the last occurrence of u, s its multiplicity
+  int r = ( int )( std::upper_bound( knots_.begin(), knots_.end(), u ) - knots_.begin() ) - 1;
+  int s = 0;
+
+  while( r - s >= 0 && knots_[ r - s ] == u )
+    ++s;
+
+  if( s == 0 || s > p )
+    return 0;
+
+  num = min( num, s );
+
+  // each removal is measured against the curve before it, which is within
+  // err of the first one
+  double max_len = max_crv_len( ctrl_pnts_ );
+  point_vec pw( ctrl_pnts_.get_allocator() );
+  point_vec temp( 2 * p + 1, ctrl_pnts_.get_allocator() );
+
+  to_hom_pnts( ctrl_pnts_, pw );
+
+  double w_min = min_weight( pw );
+
+  int fout = ( 2 * r - s - p ) / 2;
+  int first = r - p;
+  int last = r - s;
+  int t;
+
+  for( t = 0; t < num; ++t )
+  {
+    int off = first - 1;
+    int i = first;
+    int j = last;
+    int ii = 1;
+    int jj = last - off;
+    bool is_ok = true;
+    HomDiff diff = { 0.0, 0.0 };
+
+    temp[ 0 ] = pw[ off ];
+    temp[ last + 1 - off ] = pw[ last + 1 ];
+
+    while( j - i > t )
+    {
+      double den_i = knots_[ i + ord + t ] - knots_[ i ];
+      double den_j = knots_[ j + ord ] - knots_[ j - t ];
+      double alf_i = den_i != 0.0 ? ( u - knots_[ i ] ) / den_i : 0.0;
+      double alf_j = den_j != 0.0 ? ( u - knots_[ j - t ] ) / den_j : 1.0;
+
+      if( alf_i == 0.0 || alf_j == 1.0 )
+      {
+        is_ok = false;
+        break;
+      }
+
+      const CAGD_POINT &prev = temp[ ii - 1 ];
+      const CAGD_POINT &next = temp[ jj + 1 ];
+
+      temp[ ii ].x = ( pw[ i ].x - ( 1.0 - alf_i ) * prev.x ) / alf_i;
+      temp[ ii ].y = ( pw[ i ].y - ( 1.0 - alf_i ) * prev.y ) / alf_i;
+      temp[ ii ].z = ( pw[ i ].z - ( 1.0 - alf_i ) * prev.z ) / alf_i;
+      temp[ jj ].x = ( pw[ j ].x - alf_j * next.x ) / ( 1.0 - alf_j );
+      temp[ jj ].y = ( pw[ j ].y - alf_j * next.y ) / ( 1.0 - alf_j );
+      temp[ jj ].z = ( pw[ j ].z - alf_j * next.z ) / ( 1.0 - alf_j );
+      ++i;
+      ++ii;
+      --j;
+      --jj;
+    }
+
+    if( !is_ok )
+      break;
 
-  for( int i = 0; i <= insert_pos - p - 1; ++i )
+    double w_new = w_min;
+
+    for( int k = 1; k < ii; ++k )
+      w_new = min( w_new, temp[ k ].z );
+
+    for( int k = jj + 1; k <= last - off; ++k )
+      w_new = min( w_new, temp[ k ].z );
+
+    if( j - i < t )
+      add_hom_diff( temp[ ii - 1 ], temp[ jj + 1 ], diff );
+    else
+    {
+      double den_i = knots_[ i + ord + t ] - knots_[ i ];
+      double alf_i = den_i != 0.0 ? ( u - knots_[ i ] ) / den_i : 0.0;
+      const CAGD_POINT &a = temp[ ii + t + 1 ];
+      const CAGD_POINT &b = temp[ ii - 1 ];
+      CAGD_POINT blend = { alf_i * a.x + ( 1.0 - alf_i ) * b.x,
+                           alf_i * a.y + ( 1.0 - alf_i ) * b.y,
+                           alf_i * a.z + ( 1.0 - alf_i ) * b.z };
+
+      add_hom_diff( pw[ i ], blend, diff );
+    }
+
+    double dist = hom_diff_to_crv( diff, max_len + err, w_new );
+
+    if( !( err + dist <= tol ) )
+      break;
+
+    err += dist;
+    w_min = w_new;
+    i = first;
+    j = last;
+
+    while( j - i > t )
+    {
+      pw[ i ] = temp[ i - off ];
+      pw[ j ] = temp[ j - off ];
+      ++i;
+      --j;
+    }
+
+    --first;
+    ++last;
+  }
+
+  if( t == 0 )
+    return 0;
+
+  for( int k = r + 1; k <= m; ++k )
+    knots_[ k - t ] = knots_[ k ];
+
+  int j = fout;
+  int i = j;
+
+  for( int k = 1; k < t; ++k )
   {
-    new_ctrl_pnts.push_back( ctrl_pnts_[ i ] );
+    if( k % 2 == 1 )
+      ++i;
+    else
+      --j;
   }
 
-  for( int i = max( 1, insert_pos - p ); i <= min( insert_pos - 1, static_cast< int >( ctrl_pnts_.size() - 1 ) ); ++i )
+  for( int k = i + 1; k <= n; ++k )
+    pw[ j++ ] = pw[ k ];
+
+  knots_.resize( knots_.size() - t );
+  pw.resize( pw.size() - t );
+  from_hom_pnts( pw, ctrl_pnts_ );
+  updateUniqueKnotsAndMultiplicity();
+
+  return t;
+}
+
+/******************************************************************************
+* BSpline::removeKnots
+******************************************************************************/
+int BSpline::removeKnots( double tol )
+{
+  if( knots_.size() != ctrl_pnts_.size() + order_ )
+    return 0;
+
+  int p = order_ - 1;
+  double dom_start = knots_[ p ];
+  double dom_end = knots_[ ctrl_pnts_.size() ];
+  double_vec interior;
+  int num_removed = 0;
+  double used = 0.0;
+
+  for( auto knot : knots_ )
   {
-    double alpha = ( new_knot - knots_[ i ] ) / ( knots_[ i + p + 1 ] - knots_[ i ] );
-    CAGD_POINT new_point;
-    new_point.x = ( 1.0 - alpha ) * ctrl_pnts_[ i - 1 ].x + alpha * ctrl_pnts_[ i ].x;
-    new_point.y = ( 1.0 - alpha ) * ctrl_pnts_[ i - 1 ].y + alpha * ctrl_pnts_[ i ].y;
-    new_point.z = ( 1.0 - alpha ) * ctrl_pnts_[ i - 1 ].z + alpha * ctrl_pnts_[ i ].z;\
-    new_ctrl_pnts.push_back( new_point );
+    if( knot > dom_start && knot < dom_end && ( interior.empty() || interior.back() != knot ) )
+      interior.push_back( knot );
   }
 
-  for( size_t i = insert_pos; i < ctrl_pnts_.size(); ++i )
+  for( auto knot : interior )
   {
-    new_ctrl_pnts.push_back( ctrl_pnts_[ i ] );
+    double err;
+
+    num_removed += removeKnot( knot, order_, tol - used, err );
+    used += err;
   }
 
-  ctrl_pnts_ = new_ctrl_pnts;
+  return num_removed;
 }
 
 /******************************************************************************
-* BSpline::updateKnot
+* BSpline::clampKnots
 ******************************************************************************/
-void BSpline::updateKnot( int knot_idx, double new_param )
+bool BSpline::clampKnots()
 {
-  if( ( size_t )knot_idx >= knots_.size() )
-    throw std::runtime_error( "wrong knot idx" );
+  int n = ( int )ctrl_pnts_.size() - 1;
+  int p = order_ - 1;
 
-  knots_[ knot_idx ] = new_param;
-  ensureNonDecreasingKnotVector();
+  if( p < 1 || n < p || knots_.size() != ctrl_pnts_.size() + order_ ||
+      !( knots_[ p ] < knots_[ n + 1 ] ) )
+    return false;
+
+  double dom_start = knots_[ p ];
+  double dom_end = knots_[ n + 1 ];
+  int num_start = ( int )std::count( knots_.begin(), knots_.end(), dom_start );
+  int num_end = ( int )std::count( knots_.begin(), knots_.end(), dom_end );
+  double_vec ends( knots_.get_allocator() );
+
+  ends.insert( ends.end(), max( 0, order_ - num_start ), dom_start );
+  ends.insert( ends.end(), max( 0, order_ - num_end ), dom_end );
+
+  if( !refineKnotVector( ends ) )
+    return false;
+
+  // the points whose basis functions end before the domain or start after it
+  while( knots_[ order_ ] <= dom_start )
+  {
+    knots_.erase( knots_.begin() );
+    ctrl_pnts_.erase( ctrl_pnts_.begin() );
+  }
+
+  while( knots_[ knots_.size() - 1 - order_ ] >= dom_end )
+  {
+    knots_.pop_back();
+    ctrl_pnts_.pop_back();
+  }
+
+  is_open_ = true;
   updateUniqueKnotsAndMultiplicity();
+
+  return true;
 }
 
 /******************************************************************************
-* BSpline::rmvKnot
+* BSpline::decomposeToBezier
 ******************************************************************************/
-void BSpline::rmvKnot( int knot_idx )
+bool BSpline::decomposeToBezier( double_vec &joints, int_vec &joint_mults )
 {
-  double knot = knots_[ knot_idx ];
+  point_vec saved_pnts( ctrl_pnts_ );
+  double_vec saved_knots( knots_ );
+  bool was_open = is_open_;
+  int p = order_ - 1;
+  double_vec splits( knots_.get_allocator() );
 
-  if( ( size_t )knot_idx >= knots_.size() )
-    throw std::runtime_error( "wrong knot idx" );
+  // a failure half way leaves the curve as it was
+  auto restore = [ & ]()
+  {
+    ctrl_pnts_.assign( saved_pnts.begin(), saved_pnts.end() );
+    knots_.assign( saved_knots.begin(), saved_knots.end() );
+    is_open_ = was_open;
+    updateUniqueKnotsAndMultiplicity();
+    return false;
+  };
 
-  knots_.erase( knots_.begin() + knot_idx );
+  if( !clampKnots() )
+    return restore();
 
-  updateUniqueKnotsAndMultiplicity();
+  joints.assign( u_vec_.begin() + 1, u_vec_.end() - 1 );
+  joint_mults.clear();
+
+  for( size_t k = 1; k + 1 < u_vec_.size(); ++k )
+  {
+    int mult = min( ( int )multiplicity_[ k ], p );
+
+    joint_mults.push_back( mult );
+    splits.insert( splits.end(), p - mult, u_vec_[ k ] );
+  }
+
+  if( !refineKnotVector( splits ) ||
+      ctrl_pnts_.size() != joints.size() * p + p + 1 )
+    return restore();
+
+  is_uni_ = false;
+
+  return true;
+}
+
+/******************************************************************************
+* BSpline::elevateDegree
+******************************************************************************/
+// Splits into Bezier segments, elevates each one and removes the knots the
+// segments no longer need (The NURBS Book, 5.5). Only round off is allowed in
+// those removals, the joints get back exactly the continuity they had
+bool BSpline::elevateDegree( int times )
+{
+  if( times == 0 )
+    return true;
+
+  double_vec joints( knots_.get_allocator() );
+  int_vec joint_mults( knots_.get_allocator() );
+
+  if( times < 0 || !decomposeToBezier( joints, joint_mults ) )
+    return false;
 
-  point_vec new_ctrl_pnts;
   int p = order_ - 1;
+  int q = p + times;
+  double dom_start = knots_.front();
+  double dom_end = knots_.back();
+  point_vec pw( ctrl_pnts_.get_allocator() );
+  point_vec seg( ctrl_pnts_.get_allocator() );
+  point_vec elevated( ctrl_pnts_.get_allocator() );
+  point_vec res( ctrl_pnts_.get_allocator() );
+  double_vec res_knots( knots_.get_allocator() );
+
+  to_hom_pnts( ctrl_pnts_, pw );
+  res.reserve( ( joints.size() + 1 ) * q + 1 );
+
+  for( size_t j = 0; j <= joints.size(); ++j )
+  {
+    seg.assign( pw.begin() + j * p, pw.begin() + j * p + p + 1 );
+
+    for( int t = 0; t < times; ++t )
+    {
+      elevate_bezier_hom( seg, elevated );
+      seg.swap( elevated );
+    }
+
+    res.insert( res.end(), seg.begin() + ( j > 0 ? 1 : 0 ), seg.end() );
+  }
+
+  res_knots.insert( res_knots.end(), q + 1, dom_start );
+
+  for( auto joint : joints )
+    res_knots.insert( res_knots.end(), q, joint );
+
+  res_knots.insert( res_knots.end(), q + 1, dom_end );
+
+  from_hom_pnts( res, ctrl_pnts_ );
+  knots_.swap( res_knots );
+  order_ = q + 1;
+  updateUniqueKnotsAndMultiplicity();
 
-  for( int i = 0; i <= knot_idx - p - 1; ++i )
-    new_ctrl_pnts.push_back( ctrl_pnts_[ i ] );
+  double exact_tol = K_ROUND_OFF_TOL * ( 1.0 + max_crv_len( ctrl_pnts_ ) ) /
+                     min_weight( ctrl_pnts_ );
 
-  for( int i = knot_idx - p; i <= knot_idx - 1; ++i )
+  for( size_t k = 0; k < joints.size(); ++k )
   {
-    double alpha = ( knot - knots_[ i ] ) / ( knots_[ i + p + 1 ] - knots_[ i ] );
-    CAGD_POINT new_point;
-    new_point.x = ( ctrl_pnts_[ i ].x - ( 1.0 - alpha ) * ctrl_pnts_[ i - 1 ].x ) / alpha;
-    new_point.y = ( ctrl_pnts_[ i ].y - ( 1.0 - alpha ) * ctrl_pnts_[ i - 1 ].y ) / alpha;
-    new_ctrl_pnts.push_back( new_point );
+    double err;
+    removeKnot( joints[ k ], p - joint_mults[ k ], exact_tol, err );
   }
 
-  for( size_t i = knot_idx; i < ctrl_pnts_.size(); ++i )
-    new_ctrl_pnts.push_back( ctrl_pnts_[ i ] );
+  return true;
+}
+
+/******************************************************************************
+* BSpline::reduceDegree
+******************************************************************************/
+// Reduces each Bezier segment of the curve (The NURBS Book, 5.6), the largest
+// segment error is how far the curve moves. What is left of tol then goes to
+// taking each joint to one less than the multiplicity it had, the continuity
+// it had, as elevation adds one to each
+bool BSpline::reduceDegree( double tol, double &err )
+{
+  err = 0.0;
+
+  if( order_ < 3 )
+    return false;
+
+  point_vec saved_pnts( ctrl_pnts_ );
+  double_vec saved_knots( knots_ );
+  bool was_open = is_open_;
+  bool was_uni = is_uni_;
+  double_vec joints( knots_.get_allocator() );
+  int_vec joint_mults( knots_.get_allocator() );
+
+  auto restore = [ & ]()
+  {
+    ctrl_pnts_.assign( saved_pnts.begin(), saved_pnts.end() );
+    knots_.assign( saved_knots.begin(), saved_knots.end() );
+    is_open_ = was_open;
+    is_uni_ = was_uni;
+    updateUniqueKnotsAndMultiplicity();
+    return false;
+  };
+
+  if( !decomposeToBezier( joints, joint_mults ) )
+    return restore();
+
+  int p = order_ - 1;
+  double max_len = max_crv_len( ctrl_pnts_ );
+  double w_min = HUGE_VAL;
+  HomDiff diff = { 0.0, 0.0 };
+  double dom_start = knots_.front();
+  double dom_end = knots_.back();
+  point_vec pw( ctrl_pnts_.get_allocator() );
+  point_vec seg( ctrl_pnts_.get_allocator() );
+  point_vec reduced( ctrl_pnts_.get_allocator() );
+  point_vec res( ctrl_pnts_.get_allocator() );
+  double_vec res_knots( knots_.get_allocator() );
+
+  to_hom_pnts( ctrl_pnts_, pw );
+  res.reserve( ( joints.size() + 1 ) * ( p - 1 ) + 1 );
+
+  for( size_t j = 0; j <= joints.size(); ++j )
+  {
+    seg.assign( pw.begin() + j * p, pw.begin() + j * p + p + 1 );
+    if( !reduce_bezier_hom( seg, reduced, diff ) )
+      return restore();
+
+    w_min = min( w_min, min_weight( reduced ) );
+    err = hom_diff_to_crv( diff, max_len, w_min );
+
+    if( !( err <= tol ) )
+      return restore();
+
+    res.insert( res.end(), reduced.begin() + ( j > 0 ? 1 : 0 ), reduced.end() );
+  }
+
+  res_knots.insert( res_knots.end(), p, dom_start );
+
+  for( auto joint : joints )
+    res_knots.insert( res_knots.end(), p - 1, joint );
+
+  res_knots.insert( res_knots.end(), p, dom_end );
 
-  ctrl_pnts_ = new_ctrl_pnts;
+  from_hom_pnts( res, ctrl_pnts_ );
+  knots_.swap( res_knots );
+  order_ = p;
+  updateUniqueKnotsAndMultiplicity();
+
+  for( size_t k = 0; k < joints.size(); ++k )
+  {
+    double used;
+
+    removeKnot( joints[ k ], p - joint_mults[ k ], tol - err, used );
+    err += used;
+  }
+
+  return true;
 }
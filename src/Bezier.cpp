@@ -2,10 +2,12 @@
 #include <stdexcept>
 #include "Bezier.h"
 #include <cmath>
+#include <cstring>
 
 #include "options.h"
 #include "color.h"
 #include "crv_utils.h"
+#include "tess_cache.h"
 #include <vectors.h>
 #include <BSpline.h>
 
@@ -25,6 +27,7 @@ void Bezier::print() const
 void Bezier::rmv_ctrl_pnt( int idx )
 {
   Curve::rmv_ctrl_pnt( idx );
+  update_eval_cache();
 }
 
 /******************************************************************************
@@ -34,6 +37,7 @@ void Bezier::add_ctrl_pnt( CAGD_POINT &ctrl_pnt, int idx )
 {
   Curve::add_ctrl_pnt( ctrl_pnt, idx );
   order_++;
+  update_eval_cache();
 }
 
 /******************************************************************************
@@ -192,37 +196,55 @@ void Bezier::connectG1_bspline( const BSpline *bspline )
 /******************************************************************************
 * Bezier::show_crv
 ******************************************************************************/
-bool Bezier::show_crv( int chg_ctrl_idx, CtrlOp ) const
+bool Bezier::show_crv( int chg_ctrl_idx, CtrlOp )
 {
-  MP_cache_.clear();
-  MW_cache_.clear();
+  point_vec pnts;
+
+  // control points may have been edited directly since the last show
+  update_eval_cache();
+
+  if( !tess_cache_find( this, pnts ) )
+    sample_crv( pnts );
 
   cagdSetColor( color_[ 0 ], color_[ 1 ], color_[ 2 ] );
 
-  unsigned int def_num_steps = get_default_num_steps();
+  if( seg_ids_.size() > 0 )
+    cagdReusePolyline( seg_ids_[ 0 ], pnts.data(), pnts.size() );
+  else
+  {
+    int seg_id = cagdAddPolyline( pnts.data(), pnts.size() );
+    seg_ids_.push_back( seg_id );
+    map_seg_to_crv( seg_id, this );
+  }
 
-  double jump = 1.0 / ( ( double )def_num_steps - 1 );
+  set_default_color();
 
-  auto pnts = new CAGD_POINT[ def_num_steps ];
+  return true;
+}
 
-  if( pnts != NULL )
-  {
-    for( unsigned int i = 0; i < def_num_steps; ++i )
-      pnts[ i ] = evaluate( jump * i );
+/******************************************************************************
+* Bezier::sample_crv
+******************************************************************************/
+bool Bezier::sample_crv( point_vec &pnts ) const
+{
+  point_vec MP;
+  double_vec MW;
+  bool is_valid = is_cache_valid();
 
-    if( seg_ids_.size() > 0 )
-      cagdReusePolyline( seg_ids_[ 0 ], pnts, def_num_steps );
-    else
-    {
-      int seg_id = cagdAddPolyline( pnts, def_num_steps );
-      seg_ids_.push_back( seg_id );
-      map_seg_to_crv( seg_id, ( Curve * )this );
-    }
+  if( !is_valid )
+    computeMP( MP, MW );
 
-    set_default_color();
-  }
+  const point_vec &use_MP = is_valid ? MP_cache_ : MP;
+  const double_vec &use_MW = is_valid ? MW_cache_ : MW;
+
+  unsigned int def_num_steps = get_default_num_steps();
+
+  double jump = 1.0 / ( ( double )def_num_steps - 1 );
 
-  delete[] pnts;
+  pnts.resize( def_num_steps );
+
+  for( unsigned int i = 0; i < def_num_steps; ++i )
+    pnts[ i ] = evaluateMP( use_MP, use_MW, jump * i );
 
   return true;
 }
@@ -265,11 +287,11 @@ void Bezier::calculateMatrixM( std::vector<std::vector<GLdouble>> &M ) const
 /******************************************************************************
 * Bezier::computeMP
 ******************************************************************************/
-void Bezier::computeMP() const
+void Bezier::computeMP( point_vec &MP, double_vec &MW ) const
 {
   int n = ctrl_pnts_.size() - 1;
-  MP_cache_.resize( n + 1 );
-  MW_cache_.resize( n + 1 );
+  MP.resize( n + 1 );
+  MW.resize( n + 1 );
 
   // Construct the Bernstein basis matrix M
   std::vector<std::vector<GLdouble>> base_matrix;
@@ -280,26 +302,68 @@ void Bezier::computeMP() const
   {
     double weight_sum = 0.0;
 
-    MP_cache_[ i ].x = 0.0;
-    MP_cache_[ i ].y = 0.0;
-    MW_cache_[i] = 0.0;
+    MP[ i ].x = 0.0;
+    MP[ i ].y = 0.0;
+    MW[ i ] = 0.0;
 
     for( int j = 0; j <= n; ++j )
     {
       double w_base = base_matrix[ i ][ j ] * ctrl_pnts_[ j ].z;
-      MP_cache_[ i ].x += w_base * ctrl_pnts_[ j ].x;
-      MP_cache_[ i ].y += w_base * ctrl_pnts_[ j ].y;
-      MW_cache_[i] += w_base;
+      MP[ i ].x += w_base * ctrl_pnts_[ j ].x;
+      MP[ i ].y += w_base * ctrl_pnts_[ j ].y;
+      MW[ i ] += w_base;
     }
   }
 }
 
+/******************************************************************************
+* Bezier::update_eval_cache
+******************************************************************************/
+void Bezier::update_eval_cache()
+{
+  computeMP( MP_cache_, MW_cache_ );
+  cache_pnts_.assign( ctrl_pnts_.begin(), ctrl_pnts_.end() );
+}
+
+/******************************************************************************
+* Bezier::is_cache_valid
+******************************************************************************/
+bool Bezier::is_cache_valid() const
+{
+  return !ctrl_pnts_.empty() &&
+         MP_cache_.size() == ctrl_pnts_.size() &&
+         MW_cache_.size() == ctrl_pnts_.size() &&
+         cache_pnts_.size() == ctrl_pnts_.size() &&
+         memcmp( cache_pnts_.data(),
+                 ctrl_pnts_.data(),
+                 ctrl_pnts_.size() * sizeof( CAGD_POINT ) ) == 0;
+}
+
 /******************************************************************************
 * Bezier::evaluate
 ******************************************************************************/
 CAGD_POINT Bezier::evaluate( GLdouble t ) const
 {
-  int n = ctrl_pnts_.size() - 1;
+  if( is_cache_valid() )
+    return evaluateMP( MP_cache_, MW_cache_, t );
+
+  // no cache yet, compute into locals instead of filling it from a const call
+  point_vec MP;
+  double_vec MW;
+
+  computeMP( MP, MW );
+
+  return evaluateMP( MP, MW, t );
+}
+
+/******************************************************************************
+* Bezier::evaluateMP
+******************************************************************************/
+CAGD_POINT Bezier::evaluateMP( const point_vec &MP,
+                               const double_vec &MW,
+                               GLdouble t ) const
+{
+  int n = MP.size() - 1;
 
   // Construct vector T
   std::vector<GLdouble> T( n + 1 );
@@ -311,19 +375,15 @@ CAGD_POINT Bezier::evaluate( GLdouble t ) const
     t_pow *= t;
   }
 
-  // Ensure MP is cached
-  if( MP_cache_.empty() || MW_cache_.empty() )
-    computeMP();
-
   // Compute the final result using T * MP
   CAGD_POINT point = { 0.0, 0.0, 0.0 };
   double w_sum = 0;
 
   for( int i = 0; i <= n; ++i )
   {
-    point.x += T[ i ] * MP_cache_[ i ].x;
-    point.y += T[ i ] * MP_cache_[ i ].y;
-    w_sum += T[i] * MW_cache_[i];
+    point.x += T[ i ] * MP[ i ].x;
+    point.y += T[ i ] * MP[ i ].y;
+    w_sum += T[ i ] * MW[ i ];
   }
 
   if( double_cmp( w_sum, 0.0 ) != 0 )
@@ -333,4 +393,232 @@ CAGD_POINT Bezier::evaluate( GLdouble t ) const
   }
 
   return point;
-}
\ No newline at end of file
+}
+
+/******************************************************************************
+* Bezier::elevateDegree
+******************************************************************************/
+bool Bezier::elevateDegree( int times )
+{
+  if( times == 0 )
+    return true;
+
+  if( times < 0 || ctrl_pnts_.empty() )
+    return false;
+
+  point_vec pw( ctrl_pnts_.get_allocator() );
+  point_vec elevated( ctrl_pnts_.get_allocator() );
+
+  to_hom_pnts( ctrl_pnts_, pw );
+
+  for( int i = 0; i < times; ++i )
+  {
+    elevate_bezier_hom( pw, elevated );
+    pw.swap( elevated );
+  }
+
+  from_hom_pnts( pw, ctrl_pnts_ );
+  order_ += times;
+  update_eval_cache();
+
+  return true;
+}
+
+/******************************************************************************
+* Bezier::reduceDegree
+******************************************************************************/
+bool Bezier::reduceDegree( double tol, double &err )
+{
+  err = 0.0;
+
+  if( ctrl_pnts_.size() < 3 )
+    return false;
+
+  point_vec pw( ctrl_pnts_.get_allocator() );
+  point_vec reduced( ctrl_pnts_.get_allocator() );
+
+  HomDiff diff = { 0.0, 0.0 };
+
+  to_hom_pnts( ctrl_pnts_, pw );
+
+  if( !reduce_bezier_hom( pw, reduced, diff ) )
+  {
+    err = HUGE_VAL;
+    return false;
+  }
+
+  err = hom_diff_to_crv( diff, max_crv_len( ctrl_pnts_ ), min_weight( reduced ) );
+
+  if( !( err <= tol ) )
+    return false;
+
+  from_hom_pnts( reduced, ctrl_pnts_ );
+  order_--;
+  update_eval_cache();
+
+  return true;
+}
+
+/******************************************************************************
+* to_hom_pnts
+******************************************************************************/
+void to_hom_pnts( const point_vec &pnts, point_vec &pw )
+{
+  pw.resize( pnts.size() );
+
+  for( size_t i = 0; i < pnts.size(); ++i )
+  {
+    const CAGD_POINT &pnt = pnts[ i ];
+    pw[ i ] = { pnt.x * pnt.z, pnt.y * pnt.z, pnt.z };
+  }
+}
+
+/******************************************************************************
+* from_hom_pnts
+******************************************************************************/
+void from_hom_pnts( const point_vec &pw, point_vec &pnts )
+{
+  pnts.resize( pw.size() );
+
+  for( size_t i = 0; i < pw.size(); ++i )
+  {
+    const CAGD_POINT &hom = pw[ i ];
+    pnts[ i ] = { hom.x / hom.z, hom.y / hom.z, hom.z };
+  }
+}
+
+/******************************************************************************
+* add_hom_diff
+******************************************************************************/
+void add_hom_diff( const CAGD_POINT &a, const CAGD_POINT &b, HomDiff &diff )
+{
+  double dx = a.x - b.x;
+  double dy = a.y - b.y;
+
+  diff.dxy = max( diff.dxy, std::sqrt( dx * dx + dy * dy ) );
+  diff.dw = max( diff.dw, std::fabs( a.z - b.z ) );
+}
+
+/******************************************************************************
+* hom_diff_to_crv
+******************************************************************************/
+double hom_diff_to_crv( const HomDiff &diff, double max_len, double w_min )
+{
+  if( !( w_min > 0.0 ) )
+    return HUGE_VAL;
+
+  return ( diff.dxy + max_len * diff.dw ) / w_min;
+}
+
+/******************************************************************************
+* max_crv_len
+******************************************************************************/
+double max_crv_len( const point_vec &ctrl_pnts )
+{
+  double max_len = 0.0;
+
+  for( auto &pnt : ctrl_pnts )
+    max_len = max( max_len, std::sqrt( pnt.x * pnt.x + pnt.y * pnt.y ) );
+
+  return max_len;
+}
+
+/******************************************************************************
+* min_weight
+******************************************************************************/
+double min_weight( const point_vec &pnts )
+{
+  double w_min = HUGE_VAL;
+
+  for( auto &pnt : pnts )
+    w_min = min( w_min, pnt.z );
+
+  return w_min;
+}
+
+/******************************************************************************
+* hom_comb
+******************************************************************************/
+static CAGD_POINT hom_comb( double a,
+                            const CAGD_POINT &pnt_a,
+                            double b,
+                            const CAGD_POINT &pnt_b )
+{
+  CAGD_POINT res = { a * pnt_a.x + b * pnt_b.x,
+                     a * pnt_a.y + b * pnt_b.y,
+                     a * pnt_a.z + b * pnt_b.z };
+  return res;
+}
+
+/******************************************************************************
+* elevate_bezier_hom
+******************************************************************************/
+// Q_i = i / ( p + 1 ) * P_i-1 + ( 1 - i / ( p + 1 ) ) * P_i
+void elevate_bezier_hom( const point_vec &pw, point_vec &elevated )
+{
+  int p = ( int )pw.size() - 1;
+
+  elevated.resize( p + 2 );
+  elevated[ 0 ] = pw[ 0 ];
+  elevated[ p + 1 ] = pw[ p ];
+
+  for( int i = 1; i <= p; ++i )
+  {
+    double alpha = ( double )i / ( p + 1 );
+    elevated[ i ] = hom_comb( alpha, pw[ i - 1 ], 1.0 - alpha, pw[ i ] );
+  }
+}
+
+/******************************************************************************
+* reduce_bezier_hom
+******************************************************************************/
+// Inverts the elevation from both ends at once (The NURBS Book, 5.6), for an
+// odd degree the two estimates of the middle point are averaged. The error is
+// measured by elevating the result back.
+bool reduce_bezier_hom( const point_vec &pw, point_vec &reduced, HomDiff &diff )
+{
+  int p = ( int )pw.size() - 1;
+  int r = ( p - 1 ) / 2;
+
+  reduced.resize( p );
+  reduced[ 0 ] = pw[ 0 ];
+  reduced[ p - 1 ] = pw[ p ];
+
+  for( int i = 1; i <= r && i < p - 1; ++i )
+  {
+    double alpha = ( double )i / p;
+    reduced[ i ] = hom_comb( 1.0 / ( 1.0 - alpha ), pw[ i ],
+                             -alpha / ( 1.0 - alpha ), reduced[ i - 1 ] );
+  }
+
+  for( int i = p - 2; i > r; --i )
+  {
+    double alpha = ( double )( i + 1 ) / p;
+    reduced[ i ] = hom_comb( 1.0 / alpha, pw[ i + 1 ],
+                             -( 1.0 - alpha ) / alpha, reduced[ i + 1 ] );
+  }
+
+  if( p % 2 == 1 && r > 0 && r < p - 1 )
+  {
+    double alpha = ( double )( r + 1 ) / p;
+    CAGD_POINT right = hom_comb( 1.0 / alpha, pw[ r + 1 ],
+                                 -( 1.0 - alpha ) / alpha, reduced[ r + 1 ] );
+
+    reduced[ r ] = hom_comb( 0.5, reduced[ r ], 0.5, right );
+  }
+
+  for( auto &hom : reduced )
+  {
+    if( !( hom.z > 0.0 ) )
+      return false;
+  }
+
+  point_vec back( pw.get_allocator() );
+
+  elevate_bezier_hom( reduced, back );
+
+  for( int i = 0; i <= p; ++i )
+    add_hom_diff( pw[ i ], back[ i ], diff );
+
+  return true;
+}
@@ -5,10 +5,11 @@
 #include "cagd.h"
 #include "internal.h"
 #include <stdio.h>
+#include <string.h>
 
 #define Z_NEAR  0.001
 #define Z_SHIFT 2
-#define MAX_HITS 100
+#define MAX_HITS 1024
 #define POINT_SIZE 3
 
 static WORD view = CAGD_ORTHO;
@@ -16,6 +17,7 @@ static BOOL cue = FALSE;
 static GLdouble modelView[ 16 ], projection[ 16 ];
 static GLint viewPort[ 4 ] = { 0, 0, 0, 0 };
 static GLuint hits[ MAX_HITS ];
+static GLuint pickIds[ MAX_HITS / 4 ], pickIndices[ MAX_HITS / 4 ];
 static GLint nHits;
 static GLint fuzziness = 4;
 static GLdouble sensitive = 1;
@@ -64,6 +66,23 @@ void cagdGetMoveVec( int dX, int dY, double &x, double &y )
   y = where[ 0 ].y - origin.y;
 }
 
+/* hit records are { count, zmin, zmax, names... }: the first name is the */
+/* segment id, the second (for CAGD_SEGMENT_POINTS) the point's index.     */
+static void parseHits()
+{
+  GLint i, n = nHits < 0 ? MAX_HITS / 4 : nHits;
+  GLuint *record = hits;
+  for( i = 0; i < n && record + 3 < hits + MAX_HITS; i++ )
+  {
+    if( record[ 0 ] < 1 || record + 3 + record[ 0 ] > hits + MAX_HITS )
+      break;
+    pickIds[ i ] = record[ 3 ];
+    pickIndices[ i ] = record[ 0 ] > 1 ? record[ 4 ] : CAGD_NO_INDEX;
+    record += 3 + record[ 0 ];
+  }
+  nHits = i;
+}
+
 void cagdPick( int x, int y )
 {
   glMatrixMode( GL_PROJECTION );
@@ -77,13 +96,22 @@ void cagdPick( int x, int y )
   nHits = glRenderMode( GL_RENDER );
   glPopMatrix();
   glMatrixMode( GL_MODELVIEW );
+  parseHits();
+}
+
+UINT cagdPickNextIndex( UINT *index )
+{
+  if( nHits <= 0 )
+    return 0;
+  --nHits;
+  if( index )
+    *index = pickIndices[ nHits ];
+  return pickIds[ nHits ];
 }
 
 UINT cagdPickNext()
 {
-  if( nHits > 0 )
-    return hits[ --nHits * 4 + 3 ];
-  return 0;
+  return cagdPickNextIndex( NULL );
 }
 
 BOOL cagdToObject( int x, int y, CAGD_POINT where[ 2 ] )
@@ -117,6 +145,8 @@ static void CALLBACK reDraw( void )
 
 void cagdRedraw()
 {
+  if( !isSegTableShown() )
+    return;
   reDraw();
 }
 
@@ -138,6 +168,7 @@ static void CALLBACK resize( GLsizei width, GLsizei height )
       glFrustum( -Z_NEAR, Z_NEAR, -Z_NEAR / s, Z_NEAR / s, Z_NEAR, 1 / Z_NEAR );
   glGetDoublev( GL_PROJECTION_MATRIX, projection );
   glMatrixMode( GL_MODELVIEW );
+  viewChanged();
 }
 
 WORD cagdGetView()
@@ -174,6 +205,27 @@ void cagdSetDepthCue( BOOL enable )
 void saveModelView()
 {
   glGetDoublev( GL_MODELVIEW_MATRIX, modelView );
+  viewChanged();
+}
+
+void cagdGetViewState( CAGD_VIEW_STATE *state )
+{
+  memcpy( state->modelView, modelView, sizeof( modelView ) );
+  state->sensitive = sensitive;
+  state->fuzziness = fuzziness;
+  state->view = view;
+  state->cue = cue;
+}
+
+void cagdSetViewState( const CAGD_VIEW_STATE *state )
+{
+  glMatrixMode( GL_MODELVIEW );
+  glLoadMatrixd( state->modelView );
+  saveModelView();
+  cagdSetView( state->view );
+  cagdSetDepthCue( state->cue );
+  sensitive = state->sensitive;
+  fuzziness = state->fuzziness > 0 ? state->fuzziness : 1;
 }
 
 static void shift()
@@ -273,7 +325,7 @@ void cagdReset()
   glMatrixMode( GL_MODELVIEW );
   glLoadIdentity();
   shift();
-  glGetDoublev( GL_MODELVIEW_MATRIX, modelView );
+  saveModelView();
 }
 
 void cagdBegin( PCSTR title, int width, int height )
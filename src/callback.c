@@ -23,7 +23,9 @@ static PSTR defaultHelpText =
 "<Shift> + Left mouse button -- translate along X/Y axes;\n"
 "<Shift> + Right mouse button -- translate along Z axe;\n"
 "<+> -- increase scale;\n"
-"<-> -- decrease scale;";
+"<-> -- decrease scale;\n"
+"<Ctrl> + <Z> / <Y> -- undo / redo;\n"
+"<Esc> -- cancel loading a file;";
 
 static CALLBACK_ENTRY list[ CAGD_LAST ] = { { NULL, NULL } };
 static WORD state = 0;
@@ -78,6 +80,11 @@ static void callback( UINT message, int x, int y )
   list[ message ].callback( x, y, list[ message ].data );
 }
 
+void viewChanged()
+{
+  callback( CAGD_VIEWCHANGE, 0, 0 );
+}
+
 /* BUGFIX: mplav@csd 17/12/96: CALLBACK modificator for proper linkage. */
 /* Error appeared on WinNT 4.0: menu was not properly redrawn. */
 static LRESULT CALLBACK command( HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam )
@@ -300,12 +307,15 @@ static LRESULT CALLBACK command( HWND hWnd, UINT message, WPARAM wParam, LPARAM
       new_pos[0] = p.x;
       new_pos[1] = p.y;
 
-      int pnt_id = get_active_pt_id();
-      update_ctrl_pnt_callback( pnt_id, new_pos[0], new_pos[1] );
-      Curve *p_crv = get_pnt_crv( pnt_id );
-      p_crv->show_ctrl_poly();
-      p_crv->show_crv();
-      cagdRedraw();
+      Curve *p_crv = update_ctrl_pnt_callback( get_active_pt_id(),
+                                               get_active_pt_idx(),
+                                               new_pos[0],
+                                               new_pos[1] );
+      if( p_crv != nullptr )
+      {
+        p_crv->show_crv();
+        cagdRedraw();
+      }
     }
     else
     {
@@ -348,6 +358,15 @@ static LRESULT CALLBACK command( HWND hWnd, UINT message, WPARAM wParam, LPARAM
         return 0;
       state |= ( wParam == VK_CONTROL ) ? MK_CONTROL : MK_SHIFT;
       return 0;
+    case 'Z':
+    case 'Y':
+      if( !( state & MK_CONTROL ) )
+        break;
+      callback( CAGD_MENU, wParam == 'Z' ? CAGD_UNDO : CAGD_REDO, 0 );
+      return 0;
+    case VK_ESCAPE:
+      callback( CAGD_MENU, CAGD_CANCEL_LOAD, 0 );
+      return 0;
     }
     break;
 
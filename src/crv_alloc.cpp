@@ -0,0 +1,31 @@
+#include "crv_alloc.h"
+#include "scene.h"
+
+static thread_local std::pmr::memory_resource *p_thread_res = nullptr;
+
+/******************************************************************************
+* get_crv_resource
+******************************************************************************/
+std::pmr::memory_resource *get_crv_resource()
+{
+  if( p_thread_res != nullptr )
+    return p_thread_res;
+
+  return &get_scene()->pool;
+}
+
+/******************************************************************************
+* release_crv_resource
+******************************************************************************/
+void release_crv_resource()
+{
+  get_scene()->pool.release();
+}
+
+/******************************************************************************
+* set_thread_crv_resource
+******************************************************************************/
+void set_thread_crv_resource( std::pmr::memory_resource *p_res )
+{
+  p_thread_res = p_res;
+}
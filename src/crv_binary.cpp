@@ -0,0 +1,549 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "crv_binary.h"
+#include "crv_codec.h"
+#include "crv_load.h"
+#include "crv_utils.h"
+#include "BSpline.h"
+#include "Bezier.h"
+#include "vectors.h"
+#include "scene.h"
+#include "mapped_file.h"
+
+static const char K_CAGDB_MAGIC[ 8 ] = { 'C', 'A', 'G', 'D', 'B', 0, 0, 0 };
+
+/******************************************************************************
+* align_offset
+******************************************************************************/
+static uint64_t align_offset( uint64_t offset )
+{
+  return ( offset + K_CAGDB_ALIGN - 1 ) / K_CAGDB_ALIGN * K_CAGDB_ALIGN;
+}
+
+/******************************************************************************
+* place_cagdb_section
+******************************************************************************/
+void place_cagdb_section( CagdbSection &section,
+                          uint64_t &offset,
+                          uint64_t count,
+                          size_t elem_size )
+{
+  section.offset = align_offset( offset );
+  section.count = count;
+  offset = section.offset + count * elem_size;
+}
+
+/******************************************************************************
+* pad_to
+******************************************************************************/
+static void pad_to( std::ofstream &ofs, uint64_t offset )
+{
+  static const char zeros[ K_CAGDB_ALIGN ] = {};
+  uint64_t pos = ( uint64_t )ofs.tellp();
+
+  if( pos < offset )
+    ofs.write( zeros, ( std::streamsize )( offset - pos ) );
+}
+
+/******************************************************************************
+* has_small_weights
+******************************************************************************/
+// weights that packing could round to zero
+static bool has_small_weights( const std::vector< double > &hom_pnts, double tol )
+{
+  for( size_t i = 2; i < hom_pnts.size(); i += 3 )
+  {
+    if( fabs( hom_pnts[ i ] ) <= 2.0 * tol )
+      return true;
+  }
+
+  return false;
+}
+
+/******************************************************************************
+* get_pnt_pack_tol
+******************************************************************************/
+// The tolerance of x * w, y * w, w that keeps x and y within tol. An error of
+// e in each moves x by at most e * ( 1 + |x| ) / ( w - e ).
+static double get_pnt_pack_tol( const std::vector< double > &hom_pnts, double tol )
+{
+  double w_min = HUGE_VAL;
+  double max_coord = 0.0;
+
+  for( size_t i = 0; i + 2 < hom_pnts.size(); i += 3 )
+  {
+    double w = fabs( hom_pnts[ i + 2 ] );
+
+    if( w == 0.0 )
+      return 0.0;
+
+    w_min = min( w_min, w );
+    max_coord = max( max_coord, fabs( hom_pnts[ i ] ) / w );
+    max_coord = max( max_coord, fabs( hom_pnts[ i + 1 ] ) / w );
+  }
+
+  if( w_min == HUGE_VAL )
+    return tol;
+
+  return tol * w_min / ( 1.0 + max_coord + tol );
+}
+
+/******************************************************************************
+* keeps_knot_mults
+******************************************************************************/
+// rounding may merge knots that are close, which changes the multiplicities
+// and may push one above the order
+static bool keeps_knot_mults( const std::vector< CagdbCurve > &dir,
+                              const std::vector< double > &knots,
+                              const std::vector< uint8_t > &packed_knots )
+{
+  std::vector< double > unpacked;
+
+  if( !decode_doubles( packed_knots.data(), packed_knots.data() + packed_knots.size(), unpacked ) ||
+      unpacked.size() != knots.size() )
+    return false;
+
+  for( auto &entry : dir )
+  {
+    for( uint64_t i = entry.first_knot + 1; i < entry.first_knot + entry.num_knots; ++i )
+    {
+      if( ( knots[ i - 1 ] == knots[ i ] ) != ( unpacked[ i - 1 ] == unpacked[ i ] ) )
+        return false;
+    }
+  }
+
+  return true;
+}
+
+/******************************************************************************
+* is_binary_file_path
+******************************************************************************/
+bool is_binary_file_path( const std::string &file_path )
+{
+  size_t ext_len = strlen( K_CAGDB_EXT );
+
+  if( file_path.size() < ext_len )
+    return false;
+
+  return _stricmp( file_path.c_str() + file_path.size() - ext_len, K_CAGDB_EXT ) == 0;
+}
+
+/******************************************************************************
+* save_binary_file
+******************************************************************************/
+bool save_binary_file( const std::string &file_path, double pack_tol )
+{
+  const SlotMap< Curve * > &crvs = get_scene()->curves;
+  uint32_t num_crvs = ( uint32_t )crvs.size();
+
+  std::vector< CagdbCurve > dir( num_crvs );
+  std::vector< int32_t > orders( num_crvs );
+  std::vector< uint32_t > flags( num_crvs );
+  std::vector< uint8_t > colors( 4 * ( size_t )num_crvs );
+  uint64_t num_knots = 0;
+  uint64_t num_pnts = 0;
+
+  for( uint32_t i = 0; i < num_crvs; ++i )
+  {
+    const Curve *p_crv = crvs[ i ];
+
+    dir[ i ].first_knot = num_knots;
+    dir[ i ].first_pnt = num_pnts;
+    dir[ i ].num_knots = 0;
+    dir[ i ].num_pnts = ( uint32_t )p_crv->ctrl_pnts_.size();
+    orders[ i ] = p_crv->order_;
+    flags[ i ] = 0;
+
+    if( p_crv->kind_ == CurveType::BSPLINE )
+    {
+      const BSpline *p_bspline = static_cast< const BSpline * >( p_crv );
+
+      dir[ i ].num_knots = ( uint32_t )p_bspline->knots_.size();
+      flags[ i ] |= K_CAGDB_BSPLINE;
+
+      if( p_bspline->is_open_ )
+        flags[ i ] |= K_CAGDB_OPEN;
+
+      if( p_bspline->is_uni_ )
+        flags[ i ] |= K_CAGDB_UNI;
+    }
+
+    colors[ 4 * i + 0 ] = p_crv->color_[ 0 ];
+    colors[ 4 * i + 1 ] = p_crv->color_[ 1 ];
+    colors[ 4 * i + 2 ] = p_crv->color_[ 2 ];
+    colors[ 4 * i + 3 ] = 0;
+
+    num_knots += dir[ i ].num_knots;
+    num_pnts += dir[ i ].num_pnts;
+  }
+
+  std::vector< double > knots;
+  std::vector< double > hom_pnts;
+
+  knots.reserve( num_knots );
+  hom_pnts.reserve( 3 * num_pnts );
+
+  for( auto p_crv : crvs )
+  {
+    if( p_crv->kind_ == CurveType::BSPLINE )
+    {
+      const double_vec &crv_knots = static_cast< const BSpline * >( p_crv )->knots_;
+      knots.insert( knots.end(), crv_knots.begin(), crv_knots.end() );
+    }
+
+    for( auto &pnt : p_crv->ctrl_pnts_ )
+    {
+      hom_pnts.push_back( pnt.x * pnt.z );
+      hom_pnts.push_back( pnt.y * pnt.z );
+      hom_pnts.push_back( pnt.z );
+    }
+  }
+
+  std::vector< uint8_t > packed_knots;
+  std::vector< uint8_t > packed_pnts;
+  double pnt_tol = pack_tol > 0.0 ? get_pnt_pack_tol( hom_pnts, pack_tol ) : 0.0;
+  bool is_packed = pnt_tol > 0.0 &&
+                   !has_small_weights( hom_pnts, pnt_tol ) &&
+                   encode_doubles( knots.data(), knots.size(), 1, pack_tol, packed_knots ) &&
+                   keeps_knot_mults( dir, knots, packed_knots ) &&
+                   encode_doubles( hom_pnts.data(), hom_pnts.size(), 3, pnt_tol, packed_pnts );
+
+  if( pack_tol > 0.0 && !is_packed )
+    print_error( "Curves can not be packed to this tolerance, saved unpacked" );
+
+  CagdbHeader header = {};
+  uint64_t offset = sizeof( CagdbHeader );
+
+  memcpy( header.magic, K_CAGDB_MAGIC, sizeof( header.magic ) );
+  header.version = K_CAGDB_VERSION;
+  header.num_crvs = num_crvs;
+  header.header_size = sizeof( CagdbHeader );
+  header.flags = is_packed ? K_CAGDB_PACKED : 0;
+
+  place_cagdb_section( header.dir, offset, num_crvs, sizeof( CagdbCurve ) );
+  place_cagdb_section( header.orders, offset, num_crvs, sizeof( int32_t ) );
+  place_cagdb_section( header.crv_flags, offset, num_crvs, sizeof( uint32_t ) );
+  place_cagdb_section( header.colors, offset, 4 * ( uint64_t )num_crvs, sizeof( uint8_t ) );
+
+  if( is_packed )
+  {
+    place_cagdb_section( header.knots, offset, packed_knots.size(), sizeof( uint8_t ) );
+    place_cagdb_section( header.pnts, offset, packed_pnts.size(), sizeof( uint8_t ) );
+  }
+  else
+  {
+    place_cagdb_section( header.knots, offset, num_knots, sizeof( double ) );
+    place_cagdb_section( header.pnts, offset, 3 * num_pnts, sizeof( double ) );
+  }
+
+  std::ofstream ofs( file_path, std::ios::binary );
+
+  if( !ofs )
+  {
+    print_error( "Error opening file for writing" );
+    return false;
+  }
+
+  ofs.write( ( const char * )&header, sizeof( header ) );
+
+  pad_to( ofs, header.dir.offset );
+  ofs.write( ( const char * )dir.data(), dir.size() * sizeof( CagdbCurve ) );
+  pad_to( ofs, header.orders.offset );
+  ofs.write( ( const char * )orders.data(), orders.size() * sizeof( int32_t ) );
+  pad_to( ofs, header.crv_flags.offset );
+  ofs.write( ( const char * )flags.data(), flags.size() * sizeof( uint32_t ) );
+  pad_to( ofs, header.colors.offset );
+  ofs.write( ( const char * )colors.data(), colors.size() );
+
+  pad_to( ofs, header.knots.offset );
+
+  if( is_packed )
+    ofs.write( ( const char * )packed_knots.data(), packed_knots.size() );
+  else
+    ofs.write( ( const char * )knots.data(), knots.size() * sizeof( double ) );
+
+  pad_to( ofs, header.pnts.offset );
+
+  if( is_packed )
+    ofs.write( ( const char * )packed_pnts.data(), packed_pnts.size() );
+  else
+    ofs.write( ( const char * )hom_pnts.data(), hom_pnts.size() * sizeof( double ) );
+
+  if( !ofs )
+  {
+    print_error( "Error writing file" );
+    return false;
+  }
+
+  return true;
+}
+
+/******************************************************************************
+* is_cagdb_section_valid
+******************************************************************************/
+bool is_cagdb_section_valid( const CagdbSection &section,
+                             uint64_t file_size,
+                             size_t elem_size )
+{
+  return section.offset % K_CAGDB_ALIGN == 0 &&
+         section.offset <= file_size &&
+         section.count <= ( file_size - section.offset ) / elem_size;
+}
+
+/******************************************************************************
+* get_header
+******************************************************************************/
+static const CagdbHeader *get_header( const MappedFile &file )
+{
+  const CagdbHeader *p_header = ( const CagdbHeader * )file.begin();
+
+  if( file.size() < sizeof( CagdbHeader ) ||
+      memcmp( p_header->magic, K_CAGDB_MAGIC, sizeof( K_CAGDB_MAGIC ) ) != 0 )
+  {
+    print_error( "Not a cagdb file" );
+    return nullptr;
+  }
+
+  if( p_header->version != K_CAGDB_VERSION ||
+      p_header->header_size < sizeof( CagdbHeader ) ||
+      ( p_header->flags & ~K_CAGDB_PACKED ) != 0 )
+  {
+    print_error( "Unsupported cagdb version" );
+    return nullptr;
+  }
+
+  uint64_t num_crvs = p_header->num_crvs;
+  bool is_packed = ( p_header->flags & K_CAGDB_PACKED ) != 0;
+  size_t value_size = is_packed ? sizeof( uint8_t ) : sizeof( double );
+
+  if( p_header->dir.count != num_crvs ||
+      p_header->orders.count != num_crvs ||
+      p_header->crv_flags.count != num_crvs ||
+      p_header->colors.count != 4 * num_crvs ||
+      ( !is_packed && p_header->pnts.count % 3 != 0 ) ||
+      !is_cagdb_section_valid( p_header->dir, file.size(), sizeof( CagdbCurve ) ) ||
+      !is_cagdb_section_valid( p_header->orders, file.size(), sizeof( int32_t ) ) ||
+      !is_cagdb_section_valid( p_header->crv_flags, file.size(), sizeof( uint32_t ) ) ||
+      !is_cagdb_section_valid( p_header->colors, file.size(), sizeof( uint8_t ) ) ||
+      !is_cagdb_section_valid( p_header->knots, file.size(), value_size ) ||
+      !is_cagdb_section_valid( p_header->pnts, file.size(), value_size ) )
+  {
+    print_error( "Corrupt cagdb file" );
+    return nullptr;
+  }
+
+  return p_header;
+}
+
+/******************************************************************************
+* get_cagdb_view
+******************************************************************************/
+bool get_cagdb_view( const MappedFile &file, CagdbView &view )
+{
+  view.p_header = get_header( file );
+
+  if( view.p_header == nullptr )
+    return false;
+
+  const CagdbHeader *p_header = view.p_header;
+  const char *base = file.begin();
+
+  view.dir = ( const CagdbCurve * )( base + p_header->dir.offset );
+  view.orders = ( const int32_t * )( base + p_header->orders.offset );
+  view.flags = ( const uint32_t * )( base + p_header->crv_flags.offset );
+  view.colors = ( const uint8_t * )( base + p_header->colors.offset );
+  view.knots = ( const double * )( base + p_header->knots.offset );
+  view.pnts = ( const double * )( base + p_header->pnts.offset );
+  view.num_knots = p_header->knots.count;
+  view.num_pnts = p_header->pnts.count / 3;
+  view.unpacked_knots.clear();
+  view.unpacked_pnts.clear();
+
+  if( p_header->flags & K_CAGDB_PACKED )
+  {
+    const uint8_t *packed_knots = ( const uint8_t * )( base + p_header->knots.offset );
+    const uint8_t *packed_pnts = ( const uint8_t * )( base + p_header->pnts.offset );
+
+    if( !decode_doubles( packed_knots, packed_knots + p_header->knots.count, view.unpacked_knots ) ||
+        !decode_doubles( packed_pnts, packed_pnts + p_header->pnts.count, view.unpacked_pnts ) ||
+        view.unpacked_pnts.size() % 3 != 0 )
+    {
+      print_error( "Corrupt cagdb file" );
+      return false;
+    }
+
+    view.knots = view.unpacked_knots.data();
+    view.pnts = view.unpacked_pnts.data();
+    view.num_knots = view.unpacked_knots.size();
+    view.num_pnts = view.unpacked_pnts.size() / 3;
+  }
+
+  return true;
+}
+
+/******************************************************************************
+* is_cagdb_curve_valid
+******************************************************************************/
+bool is_cagdb_curve_valid( const CagdbView &view, uint32_t idx )
+{
+  const CagdbCurve &entry = view.dir[ idx ];
+
+  return entry.first_knot <= view.num_knots &&
+         entry.num_knots <= view.num_knots - entry.first_knot &&
+         entry.first_pnt <= view.num_pnts &&
+         entry.num_pnts <= view.num_pnts - entry.first_pnt &&
+         is_cagdb_shape_valid( view.flags[ idx ], view.orders[ idx ],
+                               entry.num_knots, entry.num_pnts );
+}
+
+/******************************************************************************
+* is_cagdb_shape_valid
+******************************************************************************/
+bool is_cagdb_shape_valid( uint32_t flags, int32_t order, uint32_t num_knots, uint32_t num_pnts )
+{
+  if( order <= 0 )
+    return false;
+
+  // more knots than that only while the control points are still being added,
+  // see BSpline::is_miss_ctrl_pnts
+  if( flags & K_CAGDB_BSPLINE )
+    return num_knots >= ( uint64_t )num_pnts + order;
+
+  return num_knots == 0 && num_pnts == ( uint32_t )order;
+}
+
+/******************************************************************************
+* new_cagdb_curve
+******************************************************************************/
+Curve *new_cagdb_curve( uint32_t flags, int32_t order, const double *knots, uint32_t num_knots )
+{
+  Curve *p_crv;
+
+  if( flags & K_CAGDB_BSPLINE )
+  {
+    BSpline *p_bspline = new BSpline();
+
+    p_bspline->knots_.assign( knots, knots + num_knots );
+    p_bspline->is_open_ = ( flags & K_CAGDB_OPEN ) != 0;
+    p_bspline->is_uni_ = ( flags & K_CAGDB_UNI ) != 0;
+
+    for( auto knot : p_bspline->knots_ )
+    {
+      if( p_bspline->u_vec_.empty() || double_cmp( knot, p_bspline->u_vec_.back() ) > 0 )
+        p_bspline->u_vec_.push_back( knot );
+    }
+
+    p_crv = p_bspline;
+  }
+  else
+    p_crv = new Bezier();
+
+  p_crv->order_ = order;
+
+  return p_crv;
+}
+
+/******************************************************************************
+* build_cagdb_curve
+******************************************************************************/
+Curve *build_cagdb_curve( const CagdbView &view, uint32_t idx )
+{
+  const CagdbCurve &entry = view.dir[ idx ];
+  Curve *p_crv = new_cagdb_curve( view.flags[ idx ], view.orders[ idx ],
+                                  view.knots + entry.first_knot, entry.num_knots );
+  const double *crv_pnts = view.pnts + 3 * entry.first_pnt;
+
+  p_crv->ctrl_pnts_.resize( entry.num_pnts );
+
+  for( uint32_t j = 0; j < entry.num_pnts; ++j )
+  {
+    double w = crv_pnts[ 3 * j + 2 ];
+    p_crv->ctrl_pnts_[ j ] = { crv_pnts[ 3 * j ] / w, crv_pnts[ 3 * j + 1 ] / w, w };
+  }
+
+  p_crv->color_[ 0 ] = view.colors[ 4 * idx + 0 ];
+  p_crv->color_[ 1 ] = view.colors[ 4 * idx + 1 ];
+  p_crv->color_[ 2 ] = view.colors[ 4 * idx + 2 ];
+
+  return p_crv;
+}
+
+/******************************************************************************
+* load_binary_file
+******************************************************************************/
+size_t load_binary_file( const std::string &file_path )
+{
+  auto start = std::chrono::steady_clock::now();
+  size_t first_new_idx = get_scene()->curves.size();
+  MappedFile file( file_path );
+  CagdbView view;
+
+  if( !file.is_mapped() )
+  {
+    print_error( "Error opening file" );
+    return first_new_idx;
+  }
+
+  if( !get_cagdb_view( file, view ) )
+    return first_new_idx;
+
+  std::vector< Curve * > new_crvs;
+  new_crvs.reserve( view.p_header->num_crvs );
+
+  for( uint32_t i = 0; i < view.p_header->num_crvs; ++i )
+  {
+    if( !is_cagdb_curve_valid( view, i ) )
+    {
+      print_error( "Corrupt cagdb curve" );
+      continue;
+    }
+
+    new_crvs.push_back( build_cagdb_curve( view, i ) );
+  }
+
+  register_crvs( new_crvs );
+  print_load_stats( new_crvs.size(), file.size(), start );
+
+  return first_new_idx;
+}
+
+/******************************************************************************
+* convert_text_to_binary
+******************************************************************************/
+bool convert_text_to_binary( const std::string &text_path,
+                             const std::string &binary_path )
+{
+  // load into a scene of its own so the shown one is left alone
+  Scene *p_scene = scene_create();
+  Scene *p_prev = scene_select( p_scene );
+
+  load_mapped_file( text_path );
+  bool res = save_binary_file( binary_path );
+
+  scene_select( p_prev );
+  scene_destroy( p_scene );
+
+  return res;
+}
+
+/******************************************************************************
+* convert_binary_to_text
+******************************************************************************/
+bool convert_binary_to_text( const std::string &binary_path,
+                             const std::string &text_path )
+{
+  Scene *p_scene = scene_create();
+  Scene *p_prev = scene_select( p_scene );
+
+  load_binary_file( binary_path );
+  bool res = save_text_file( text_path );
+
+  scene_select( p_prev );
+  scene_destroy( p_scene );
+
+  return res;
+}
@@ -0,0 +1,337 @@
+#include <cmath>
+#include <cstring>
+
+#include "crv_codec.h"
+
+#define K_RANS_SCALE_BITS 12
+#define K_RANS_SCALE ( 1u << K_RANS_SCALE_BITS )
+#define K_RANS_LOW ( 1u << 23 ) // the state stays in [ K_RANS_LOW, K_RANS_LOW << 8 )
+#define K_RANS_MAX_FREQ ( K_RANS_SCALE - K_RANS_SCALE / 16 )
+#define K_RANS_MAX_EXPANSION 88 // decoded bytes per rANS byte at K_RANS_MAX_FREQ
+#define K_MAX_STRIDE 16
+
+// start of every stream, followed by the symbol frequencies and the rANS bytes
+typedef struct
+{
+  double quantum;
+  uint64_t num_vals;
+  uint64_t num_bytes; // varint bytes
+  uint32_t stride;
+  uint32_t rans_size;
+  uint16_t freqs[ 256 ];
+} CodecHeader;
+
+/******************************************************************************
+* zig_zag
+******************************************************************************/
+static uint64_t zig_zag( int64_t val )
+{
+  return ( ( uint64_t )val << 1 ) ^ ( uint64_t )( val >> 63 );
+}
+
+/******************************************************************************
+* un_zig_zag
+******************************************************************************/
+static int64_t un_zig_zag( uint64_t val )
+{
+  return ( int64_t )( val >> 1 ) ^ -( int64_t )( val & 1 );
+}
+
+/******************************************************************************
+* predict
+******************************************************************************/
+// linear prediction from the two previous values of the channel, wraps
+// around instead of overflowing
+static int64_t predict( int64_t prev1, int64_t prev2 )
+{
+  return ( int64_t )( 2 * ( uint64_t )prev1 - ( uint64_t )prev2 );
+}
+
+/******************************************************************************
+* get_quantum
+******************************************************************************/
+static double get_quantum( double tol )
+{
+  return std::exp2( std::floor( std::log2( 2.0 * tol ) ) );
+}
+
+/******************************************************************************
+* normalize_freqs
+******************************************************************************/
+// scales the byte counts to sum to K_RANS_SCALE, every byte seen keeps at
+// least 1
+static void normalize_freqs( const uint64_t counts[ 256 ],
+                             uint64_t total,
+                             uint16_t freqs[ 256 ] )
+{
+  uint32_t sum = 0;
+  int max_sym = 0;
+
+  for( int s = 0; s < 256; ++s )
+  {
+    freqs[ s ] = 0;
+
+    if( counts[ s ] == 0 )
+      continue;
+
+    uint64_t scaled = counts[ s ] * K_RANS_SCALE / total;
+
+    freqs[ s ] = ( uint16_t )( scaled > 0 ? scaled : 1 );
+    sum += freqs[ s ];
+
+    if( freqs[ s ] > freqs[ max_sym ] )
+      max_sym = s;
+  }
+
+  // the rounding error goes to the most frequent byte, or is taken from the
+  // biggest frequencies when the minimums overshoot
+  while( sum > K_RANS_SCALE )
+  {
+    int big = 0;
+
+    for( int s = 1; s < 256; ++s )
+    {
+      if( freqs[ s ] > freqs[ big ] )
+        big = s;
+    }
+
+    --freqs[ big ];
+    --sum;
+  }
+
+  freqs[ max_sym ] += ( uint16_t )( K_RANS_SCALE - sum );
+
+  // every byte then costs a tenth of a bit at least, which bounds how many
+  // bytes a stream can decode to. The slots go to a byte that is rare or
+  // never seen, the encoder never lands in them
+  if( freqs[ max_sym ] > K_RANS_MAX_FREQ )
+  {
+    freqs[ ( max_sym + 1 ) & 0xff ] += ( uint16_t )( freqs[ max_sym ] - K_RANS_MAX_FREQ );
+    freqs[ max_sym ] = K_RANS_MAX_FREQ;
+  }
+}
+
+/******************************************************************************
+* rans_encode
+******************************************************************************/
+static void rans_encode( const std::vector< uint8_t > &bytes,
+                         const uint16_t freqs[ 256 ],
+                         std::vector< uint8_t > &out )
+{
+  uint32_t starts[ 256 ];
+  uint32_t start = 0;
+
+  for( int s = 0; s < 256; ++s )
+  {
+    starts[ s ] = start;
+    start += freqs[ s ];
+  }
+
+  // rANS works backwards, the bytes are emitted reversed and flipped after
+  std::vector< uint8_t > rev;
+  uint32_t x = K_RANS_LOW;
+
+  rev.reserve( bytes.size() / 2 + 8 );
+
+  for( size_t i = bytes.size(); i-- > 0; )
+  {
+    uint8_t s = bytes[ i ];
+    uint32_t freq = freqs[ s ];
+    uint32_t x_max = ( ( K_RANS_LOW >> K_RANS_SCALE_BITS ) << 8 ) * freq;
+
+    while( x >= x_max )
+    {
+      rev.push_back( ( uint8_t )x );
+      x >>= 8;
+    }
+
+    x = ( ( x / freq ) << K_RANS_SCALE_BITS ) + x % freq + starts[ s ];
+  }
+
+  // the final state, read first and most significant byte first
+  for( int i = 0; i < 4; ++i )
+  {
+    rev.push_back( ( uint8_t )x );
+    x >>= 8;
+  }
+
+  out.insert( out.end(), rev.rbegin(), rev.rend() );
+}
+
+/******************************************************************************
+* encode_doubles
+******************************************************************************/
+bool encode_doubles( const double *vals,
+                     size_t count,
+                     size_t stride,
+                     double tol,
+                     std::vector< uint8_t > &out )
+{
+  if( stride == 0 || stride > K_MAX_STRIDE || count % stride != 0 || !( tol > 0.0 ) )
+    return false;
+
+  double quantum = get_quantum( tol );
+  std::vector< uint8_t > bytes;
+  int64_t prev1[ K_MAX_STRIDE ] = {};
+  int64_t prev2[ K_MAX_STRIDE ] = {};
+
+  bytes.reserve( count + 16 );
+
+  for( size_t i = 0; i < count; ++i )
+  {
+    double scaled = vals[ i ] / quantum;
+
+    if( !( std::fabs( scaled ) < 0x1p62 ) )
+      return false;
+
+    size_t c = i % stride;
+    int64_t q = std::llround( scaled );
+    uint64_t res = zig_zag( ( int64_t )( ( uint64_t )q - ( uint64_t )predict( prev1[ c ], prev2[ c ] ) ) );
+
+    prev2[ c ] = prev1[ c ];
+    prev1[ c ] = q;
+
+    while( res >= 0x80 )
+    {
+      bytes.push_back( ( uint8_t )( res | 0x80 ) );
+      res >>= 7;
+    }
+
+    bytes.push_back( ( uint8_t )res );
+  }
+
+  uint64_t counts[ 256 ] = {};
+  CodecHeader header = {};
+
+  for( auto byte : bytes )
+    ++counts[ byte ];
+
+  header.quantum = quantum;
+  header.num_vals = count;
+  header.num_bytes = bytes.size();
+  header.stride = ( uint32_t )stride;
+
+  if( !bytes.empty() )
+    normalize_freqs( counts, bytes.size(), header.freqs );
+
+  std::vector< uint8_t > packed;
+
+  if( !bytes.empty() )
+    rans_encode( bytes, header.freqs, packed );
+
+  header.rans_size = ( uint32_t )packed.size();
+
+  size_t header_pos = out.size();
+
+  out.resize( header_pos + sizeof( CodecHeader ) );
+  memcpy( out.data() + header_pos, &header, sizeof( CodecHeader ) );
+  out.insert( out.end(), packed.begin(), packed.end() );
+
+  return true;
+}
+
+/******************************************************************************
+* decode_doubles
+******************************************************************************/
+bool decode_doubles( const uint8_t *begin,
+                     const uint8_t *end,
+                     std::vector< double > &vals )
+{
+  CodecHeader header;
+
+  if( ( size_t )( end - begin ) < sizeof( CodecHeader ) )
+    return false;
+
+  memcpy( &header, begin, sizeof( CodecHeader ) );
+  begin += sizeof( CodecHeader );
+
+  if( header.stride == 0 || header.stride > K_MAX_STRIDE ||
+      header.num_vals % header.stride != 0 ||
+      header.rans_size > ( uint64_t )( end - begin ) ||
+      header.num_bytes < header.num_vals ||
+      header.num_bytes > ( uint64_t )header.num_vals * 10 ||
+      header.num_bytes > ( uint64_t )header.rans_size * K_RANS_MAX_EXPANSION )
+    return false;
+
+  // slot to byte table, one lookup per decoded byte
+  uint8_t slot_syms[ K_RANS_SCALE ];
+  uint32_t starts[ 256 ];
+  uint32_t start = 0;
+
+  for( int s = 0; s < 256; ++s )
+  {
+    if( start + header.freqs[ s ] > K_RANS_SCALE || header.freqs[ s ] > K_RANS_MAX_FREQ )
+      return false;
+
+    starts[ s ] = start;
+    memset( slot_syms + start, s, header.freqs[ s ] );
+    start += header.freqs[ s ];
+  }
+
+  if( header.num_bytes > 0 && start != K_RANS_SCALE )
+    return false;
+
+  const uint8_t *p = begin;
+  const uint8_t *p_end = begin + header.rans_size;
+  uint32_t x = 0;
+
+  if( header.num_bytes > 0 )
+  {
+    if( p_end - p < 4 )
+      return false;
+
+    for( int i = 0; i < 4; ++i )
+      x = ( x << 8 ) | *p++;
+  }
+
+  std::vector< double > decoded( ( size_t )header.num_vals );
+  int64_t prev1[ K_MAX_STRIDE ] = {};
+  int64_t prev2[ K_MAX_STRIDE ] = {};
+  uint64_t bytes_left = header.num_bytes;
+  size_t c = 0;
+
+  for( auto &val : decoded )
+  {
+    uint64_t res = 0;
+    int shift = 0;
+    uint8_t byte;
+
+    // the varint bytes come straight out of the rANS state
+    do
+    {
+      if( bytes_left-- == 0 || shift > 63 )
+        return false;
+
+      uint32_t slot = x & ( K_RANS_SCALE - 1 );
+
+      byte = slot_syms[ slot ];
+      x = header.freqs[ byte ] * ( x >> K_RANS_SCALE_BITS ) + slot - starts[ byte ];
+
+      while( x < K_RANS_LOW )
+      {
+        if( p == p_end )
+          return false;
+
+        x = ( x << 8 ) | *p++;
+      }
+
+      res |= ( uint64_t )( byte & 0x7f ) << shift;
+      shift += 7;
+    } while( byte & 0x80 );
+
+    int64_t q = ( int64_t )( ( uint64_t )un_zig_zag( res ) + ( uint64_t )predict( prev1[ c ], prev2[ c ] ) );
+
+    prev2[ c ] = prev1[ c ];
+    prev1[ c ] = q;
+    val = ( double )q * header.quantum;
+
+    if( ++c == header.stride )
+      c = 0;
+  }
+
+  if( bytes_left != 0 )
+    return false;
+
+  vals.swap( decoded );
+  return true;
+}
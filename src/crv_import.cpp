@@ -0,0 +1,229 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "crv_import.h"
+#include "crv_load.h"
+#include "crv_utils.h"
+#include "bounded_queue.h"
+#include "mapped_file.h"
+#include "scene.h"
+#include "tess_cache.h"
+
+#define K_QUEUE_CAPACITY 1024
+
+// text of one curve record, idx is its position in the file
+typedef struct
+{
+  size_t idx;
+  const char *begin;
+  const char *end;
+} RecordText;
+
+struct ImportedCurve
+{
+  ImportedCurve() : idx( 0 ), is_valid( false ), p_crv( nullptr ) {}
+
+  size_t idx;
+  bool is_valid;
+  CurveRecord rec;
+  Curve *p_crv; // built by the tessellate stage, registered by commit
+  point_vec samples;
+};
+
+// first error and error count, shared by all stages
+class ImportErrors
+{
+public:
+  ImportErrors() : num_errors_( 0 ) {}
+
+  void add( const std::string &message, size_t count = 1 )
+  {
+    std::lock_guard< std::mutex > lock( mtx_ );
+
+    if( num_errors_ == 0 )
+      first_error_ = message;
+
+    num_errors_ += count;
+  }
+
+  void report() const
+  {
+    report_parse_errors( first_error_, num_errors_ );
+  }
+
+private:
+  std::mutex mtx_;
+  std::string first_error_;
+  size_t num_errors_;
+};
+
+/******************************************************************************
+* scan_records
+******************************************************************************/
+static void scan_records( const MappedFile *p_file,
+                          BoundedQueue< RecordText > *p_out,
+                          ImportErrors *p_errors )
+{
+  CurveTextParser scanner( p_file->begin(), p_file->end(), true );
+  CurveRecord rec;
+  size_t idx = 0;
+
+  while( scanner.next( rec ) )
+    p_out->push( { idx++, scanner.record_begin(), scanner.record_end() } );
+
+  if( scanner.num_errors() > 0 )
+    p_errors->add( scanner.first_error(), scanner.num_errors() );
+
+  p_out->close();
+}
+
+/******************************************************************************
+* parse_records
+******************************************************************************/
+static void parse_records( BoundedQueue< RecordText > *p_in,
+                           BoundedQueue< ImportedCurve > *p_out,
+                           std::atomic< int > *p_num_live,
+                           ImportErrors *p_errors )
+{
+  RecordText text;
+
+  while( p_in->pop( text ) )
+  {
+    CurveTextParser parser( text.begin, text.end );
+    ImportedCurve item;
+
+    item.idx = text.idx;
+    item.is_valid = parser.next( item.rec );
+
+    if( !item.is_valid )
+    {
+      p_errors->add( parser.num_errors() > 0 ? parser.first_error() : "Error reading file" );
+      continue;
+    }
+
+    p_out->push( std::move( item ) );
+  }
+
+  // the last parser out closes the next stage
+  if( --*p_num_live == 0 )
+    p_out->close();
+}
+
+/******************************************************************************
+* tessellate_records
+******************************************************************************/
+static void tessellate_records( Scene *p_scene,
+                                BoundedQueue< ImportedCurve > *p_in,
+                                BoundedQueue< ImportedCurve > *p_out,
+                                std::atomic< int > *p_num_live )
+{
+  ImportedCurve item;
+
+  // the settings come from a copy of the importing scene, the curves from
+  // the heap so the committing thread can take them over
+  scene_select( p_scene );
+  set_thread_crv_resource( std::pmr::new_delete_resource() );
+
+  while( p_in->pop( item ) )
+  {
+    item.p_crv = build_curve( item.rec );
+    item.rec = CurveRecord(); // the curve has it now
+
+    if( item.p_crv->ctrl_pnts_.size() > 1 )
+    {
+      item.p_crv->update_eval_cache();
+      tess_cache_sample( item.p_crv, item.samples );
+    }
+
+    p_out->push( std::move( item ) );
+  }
+
+  set_thread_crv_resource( nullptr );
+  scene_select( nullptr );
+
+  if( --*p_num_live == 0 )
+    p_out->close();
+}
+
+/******************************************************************************
+* import_file_parallel
+******************************************************************************/
+size_t import_file_parallel( const std::string &file_path )
+{
+  auto start = std::chrono::steady_clock::now();
+  size_t first_new_idx = get_scene()->curves.size();
+  MappedFile file( file_path );
+
+  if( !file.is_mapped() )
+    return load_mapped_file( file_path );
+
+  int num_threads = max( 2, ( int )std::thread::hardware_concurrency() );
+  int num_parsers = max( 1, num_threads / 4 );
+  int num_tessellators = max( 1, num_threads - num_parsers - 1 );
+
+  BoundedQueue< RecordText > texts( K_QUEUE_CAPACITY );
+  BoundedQueue< ImportedCurve > parsed( K_QUEUE_CAPACITY );
+  BoundedQueue< ImportedCurve > tessellated( K_QUEUE_CAPACITY );
+  std::atomic< int > num_live_parsers = num_parsers;
+  std::atomic< int > num_live_tessellators = num_tessellators;
+  ImportErrors errors;
+  std::vector< Scene * > scenes;
+  std::vector< std::thread > threads;
+
+  threads.emplace_back( scan_records, &file, &texts, &errors );
+
+  for( int i = 0; i < num_parsers; ++i )
+    threads.emplace_back( parse_records, &texts, &parsed, &num_live_parsers, &errors );
+
+  for( int i = 0; i < num_tessellators; ++i )
+  {
+    scenes.push_back( scene_create() );
+    threads.emplace_back( tessellate_records,
+                          scenes.back(),
+                          &parsed,
+                          &tessellated,
+                          &num_live_tessellators );
+  }
+
+  // results arrive out of order, put them back in file order
+  std::vector< ImportedCurve > results;
+  ImportedCurve item;
+
+  while( tessellated.pop( item ) )
+  {
+    if( item.idx >= results.size() )
+      results.resize( item.idx + 1 );
+
+    results[ item.idx ] = std::move( item );
+  }
+
+  for( auto &thread : threads )
+    thread.join();
+
+  for( auto p_scene : scenes )
+    scene_destroy( p_scene );
+
+  std::vector< Curve * > new_crvs;
+  std::vector< point_vec > crv_pnts;
+
+  new_crvs.reserve( results.size() );
+  crv_pnts.reserve( results.size() );
+
+  for( auto &result : results )
+  {
+    if( !result.is_valid )
+      continue;
+
+    new_crvs.push_back( result.p_crv );
+    crv_pnts.push_back( std::move( result.samples ) );
+  }
+
+  register_sampled_crvs( new_crvs, crv_pnts );
+  errors.report();
+  print_load_stats( new_crvs.size(), file.size(), start );
+
+  return first_new_idx;
+}
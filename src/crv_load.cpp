@@ -0,0 +1,611 @@
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "crv_load.h"
+#include "crv_import.h"
+#include "crv_utils.h"
+#include "BSpline.h"
+#include "Bezier.h"
+#include "vectors.h"
+#include "scene.h"
+#include "mapped_file.h"
+
+#define K_PARALLEL_MIN_SIZE ( 4 << 20 )
+
+size_t parse_file( const std::string &filePath );
+
+// one line of the mapped file, without the line break
+typedef struct
+{
+  const char *begin;
+  const char *end;
+} LineView;
+
+/******************************************************************************
+* is_blank
+******************************************************************************/
+static inline bool is_blank( char c )
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/******************************************************************************
+* skip_blanks
+******************************************************************************/
+static inline const char *skip_blanks( const char *p, const char *end )
+{
+  while( p < end && is_blank( *p ) )
+    ++p;
+
+  return p;
+}
+
+/******************************************************************************
+* next_line
+******************************************************************************/
+static bool next_line( const char *&p, const char *end, LineView &line )
+{
+  while( p < end )
+  {
+    const char *eol = ( const char * )memchr( p, '\n', end - p );
+
+    if( eol == nullptr )
+      eol = end;
+
+    line.begin = skip_blanks( p, eol );
+    line.end = eol;
+    p = eol < end ? eol + 1 : end;
+
+    // the same lines skip_blank_and_comment_lines skips
+    if( line.begin < line.end && *line.begin != '#' )
+      return true;
+  }
+
+  return false;
+}
+
+/******************************************************************************
+* find_in_line
+******************************************************************************/
+static const char *find_in_line( const LineView &line, const char *str )
+{
+  size_t len = strlen( str );
+
+  for( const char *p = line.begin; p + len <= line.end; ++p )
+  {
+    if( memcmp( p, str, len ) == 0 )
+      return p;
+  }
+
+  return nullptr;
+}
+
+/******************************************************************************
+* parse_doubles
+******************************************************************************/
+// appends every number up to the first thing that is not one, like a chain
+// of operator>>
+static void parse_doubles( const char *p, const char *end, std::vector< double > &vals )
+{
+  for( ;; )
+  {
+    double val;
+
+    p = skip_blanks( p, end );
+
+    // from_chars does not take an explicit plus sign, operator>> does
+    if( p < end && *p == '+' )
+      ++p;
+
+    auto res = std::from_chars( p, end, val );
+
+    if( res.ec != std::errc() )
+      return;
+
+    vals.push_back( val );
+    p = res.ptr;
+  }
+}
+
+/******************************************************************************
+* count_numbers
+******************************************************************************/
+// appends a 0 for every token parse_doubles would take, without converting
+static void count_numbers( const char *p, const char *end, std::vector< double > &vals )
+{
+  for( ;; )
+  {
+    p = skip_blanks( p, end );
+
+    if( p == end || !( isdigit( ( unsigned char )*p ) || *p == '-' || *p == '+' || *p == '.' ) )
+      return;
+
+    while( p < end && !is_blank( *p ) && *p != '\n' )
+      ++p;
+
+    vals.push_back( 0.0 );
+  }
+}
+
+/******************************************************************************
+* CurveTextParser::CurveTextParser
+******************************************************************************/
+CurveTextParser::CurveTextParser( const char *begin, const char *end, bool is_scan ) :
+  p_( begin ),
+  end_( end ),
+  rec_begin_( begin ),
+  is_scan_( is_scan ),
+  num_errors_( 0 )
+{
+}
+
+/******************************************************************************
+* CurveTextParser::read_numbers
+******************************************************************************/
+void CurveTextParser::read_numbers( const char *p,
+                                    const char *end,
+                                    std::vector< double > &vals )
+{
+  if( is_scan_ )
+    count_numbers( p, end, vals );
+  else
+    parse_doubles( p, end, vals );
+}
+
+/******************************************************************************
+* CurveTextParser::error
+******************************************************************************/
+void CurveTextParser::error( const char *message )
+{
+  if( num_errors_++ == 0 )
+    first_error_ = message;
+}
+
+/******************************************************************************
+* CurveTextParser::add_ctrl_pnts
+******************************************************************************/
+void CurveTextParser::add_ctrl_pnts( const char *p,
+                                     const char *end,
+                                     CurveRecord &rec )
+{
+  vals_.clear();
+  read_numbers( p, end, vals_ );
+
+  for( size_t i = 0; i + 2 < vals_.size(); i += 3 )
+  {
+    CAGD_POINT pnt = { vals_[ i ] / vals_[ i + 2 ],
+                       vals_[ i + 1 ] / vals_[ i + 2 ],
+                       vals_[ i + 2 ] };
+
+    rec.pnts.push_back( pnt );
+  }
+}
+
+/******************************************************************************
+* CurveTextParser::read_knots
+******************************************************************************/
+bool CurveTextParser::read_knots( const char *line_begin,
+                                  const char *line_end,
+                                  CurveRecord &rec )
+{
+  LineView line = { line_begin, line_end };
+  const char *open_bracket = find_in_line( line, "[" );
+  const char *close_bracket = find_in_line( line, "]" );
+
+  if( open_bracket == nullptr || close_bracket == nullptr || close_bracket < open_bracket )
+  {
+    error( "Error parsing knots size" );
+    return false;
+  }
+
+  size_t num_knots = 0;
+  const char *num_begin = skip_blanks( open_bracket + 1, close_bracket );
+
+  if( std::from_chars( num_begin, close_bracket, num_knots ).ec != std::errc() )
+  {
+    error( "Error parsing knots size" );
+    return false;
+  }
+
+  const char *equal_sign = find_in_line( line, "=" );
+
+  if( equal_sign == nullptr )
+  {
+    error( "Error parsing knots" );
+    return false;
+  }
+
+  rec.is_bspline = true;
+  rec.is_open = find_in_line( line, "open" ) != nullptr;
+  rec.is_uni = find_in_line( line, "uni" ) != nullptr;
+
+  read_numbers( equal_sign + 1, line.end, rec.knots );
+
+  while( rec.knots.size() < num_knots && next_line( p_, end_, line ) )
+    read_numbers( line.begin, line.end, rec.knots );
+
+  if( rec.knots.size() != num_knots )
+  {
+    error( "Error parsing knots size" );
+    return false;
+  }
+
+  return true;
+}
+
+/******************************************************************************
+* validate_record
+******************************************************************************/
+static const char *validate_record( const CurveRecord &rec )
+{
+  for( auto &pnt : rec.pnts )
+  {
+    if( pnt.z == 0.0 || !std::isfinite( pnt.x ) || !std::isfinite( pnt.y ) )
+      return "Error in control point weight";
+  }
+
+  for( size_t i = 1; i < rec.knots.size(); ++i )
+  {
+    if( rec.knots[ i ] < rec.knots[ i - 1 ] )
+      return "Error knots are decreasing";
+  }
+
+  return nullptr;
+}
+
+/******************************************************************************
+* CurveTextParser::next
+******************************************************************************/
+bool CurveTextParser::next( CurveRecord &rec )
+{
+  LineView line;
+
+  while( next_line( p_, end_, line ) )
+  {
+    rec.order = 0;
+    rec.is_bspline = false;
+    rec.is_open = false;
+    rec.is_uni = false;
+    rec.knots.clear();
+    rec.pnts.clear();
+    rec_begin_ = line.begin;
+
+    if( std::from_chars( line.begin, line.end, rec.order ).ec != std::errc() )
+    {
+      error( "Error reading order" );
+      continue;
+    }
+
+    if( !next_line( p_, end_, line ) )
+    {
+      error( "Error reading file" );
+      return false;
+    }
+
+    if( find_in_line( line, "knots" ) != nullptr )
+    {
+      if( !read_knots( line.begin, line.end, rec ) )
+        continue;
+    }
+    else if( rec.order > 0 )
+      add_ctrl_pnts( line.begin, line.end, rec );
+    else
+    {
+      error( "Error in file format - no knots and no order" );
+      continue;
+    }
+
+    // a bspline needs knots - order points, a bezier order points
+    size_t num_pnts = rec.order;
+
+    if( rec.is_bspline )
+      num_pnts = rec.knots.size() > num_pnts ? rec.knots.size() - num_pnts : 0;
+    bool is_complete = true;
+
+    while( rec.pnts.size() < num_pnts && is_complete )
+    {
+      is_complete = next_line( p_, end_, line );
+
+      if( is_complete )
+        add_ctrl_pnts( line.begin, line.end, rec );
+    }
+
+    if( !is_complete )
+      continue;
+
+    // a scan has no values to check, the parse of the record will
+    const char *message = is_scan_ ? nullptr : validate_record( rec );
+
+    if( message == nullptr )
+      return true;
+
+    error( message );
+  }
+
+  return false;
+}
+
+/******************************************************************************
+* build_curve
+******************************************************************************/
+Curve *build_curve( const CurveRecord &rec )
+{
+  Curve *p_crv;
+
+  if( rec.is_bspline )
+  {
+    BSpline *p_bspline = new BSpline();
+
+    p_bspline->knots_.assign( rec.knots.begin(), rec.knots.end() );
+    p_bspline->is_open_ = rec.is_open;
+    p_bspline->is_uni_ = rec.is_uni;
+
+    for( auto knot : p_bspline->knots_ )
+    {
+      if( p_bspline->u_vec_.empty() || double_cmp( knot, p_bspline->u_vec_.back() ) > 0 )
+        p_bspline->u_vec_.push_back( knot );
+    }
+
+    p_crv = p_bspline;
+  }
+  else
+    p_crv = new Bezier();
+
+  p_crv->order_ = rec.order;
+  p_crv->ctrl_pnts_.assign( rec.pnts.begin(), rec.pnts.end() );
+
+  return p_crv;
+}
+
+/******************************************************************************
+* print_load_stats
+******************************************************************************/
+void print_load_stats( size_t num_crvs,
+                       size_t file_size,
+                       std::chrono::steady_clock::time_point start )
+{
+  std::chrono::duration< double > secs = std::chrono::steady_clock::now() - start;
+  double mega_bytes = ( double )file_size / ( 1024.0 * 1024.0 );
+
+  printf( "Loaded %zu curves, %.2f MB in %.3f s (%.1f MB/s)\n",
+          num_crvs,
+          mega_bytes,
+          secs.count(),
+          secs.count() > 0.0 ? mega_bytes / secs.count() : 0.0 );
+}
+
+/******************************************************************************
+* report_parse_errors
+******************************************************************************/
+void report_parse_errors( const std::string &first_error, size_t num_errors )
+{
+  if( num_errors == 0 )
+    return;
+
+  if( num_errors == 1 )
+    print_error( first_error );
+  else
+    print_error( first_error + " (and " + std::to_string( num_errors - 1 ) + " more errors)" );
+}
+
+/******************************************************************************
+* load_mapped_file
+******************************************************************************/
+size_t load_mapped_file( const std::string &file_path )
+{
+  auto start = std::chrono::steady_clock::now();
+  size_t first_new_idx = get_scene()->curves.size();
+  MappedFile file( file_path );
+
+  if( !file.is_open() )
+  {
+    print_error( "Error opening file" );
+    return first_new_idx;
+  }
+
+  if( !file.is_mapped() )
+  {
+    if( file.size() == 0 )
+      return first_new_idx;
+
+    return parse_file( file_path );
+  }
+
+  // big files are worth spreading over the cores
+  if( file.size() >= K_PARALLEL_MIN_SIZE && std::thread::hardware_concurrency() > 1 )
+    return import_file_parallel( file_path );
+
+  std::vector< Curve * > new_crvs;
+  CurveTextParser parser( file.begin(), file.end() );
+  CurveRecord rec;
+
+  while( parser.next( rec ) )
+  {
+    Curve *p_crv = build_curve( rec );
+
+    if( IS_DEBUG )
+      p_crv->print();
+
+    new_crvs.push_back( p_crv );
+  }
+
+  register_crvs( new_crvs );
+  report_parse_errors( parser.first_error(), parser.num_errors() );
+  print_load_stats( new_crvs.size(), file.size(), start );
+
+  return first_new_idx;
+}
+
+#define K_FIRST_BATCH 16
+#define K_MAX_BATCH 4096
+#define K_DRAIN_TIMER_ID 0x4c44 // cagd's own timer is 0, it is left to the app
+#define K_DRAIN_TIMER_MS 10
+
+// state shared by the UI thread and the parsing thread of a background load
+struct AsyncLoad
+{
+  std::unique_ptr< MappedFile > file;
+  std::thread worker;
+  std::atomic< bool > cancel;
+  std::chrono::steady_clock::time_point start;
+  size_t num_crvs; // registered so far, UI thread only
+
+  std::mutex mtx; // guards everything below
+  std::vector< CurveRecord > ready;
+  bool done;
+  std::string first_error;
+  size_t num_errors;
+};
+
+static AsyncLoad *p_async_load = nullptr;
+
+/******************************************************************************
+* parse_async
+******************************************************************************/
+static void parse_async( AsyncLoad *p_load )
+{
+  CurveTextParser parser( p_load->file->begin(), p_load->file->end() );
+  std::vector< CurveRecord > batch;
+  size_t batch_size = K_FIRST_BATCH;
+  CurveRecord rec;
+
+  // small batches first so the first curves show up right away
+  while( !p_load->cancel && parser.next( rec ) )
+  {
+    batch.push_back( std::move( rec ) );
+
+    if( batch.size() < batch_size )
+      continue;
+
+    std::lock_guard< std::mutex > lock( p_load->mtx );
+
+    for( auto &ready_rec : batch )
+      p_load->ready.push_back( std::move( ready_rec ) );
+
+    batch.clear();
+    batch_size = min( 2 * batch_size, ( size_t )K_MAX_BATCH );
+  }
+
+  std::lock_guard< std::mutex > lock( p_load->mtx );
+
+  for( auto &ready_rec : batch )
+    p_load->ready.push_back( std::move( ready_rec ) );
+
+  p_load->first_error = parser.first_error();
+  p_load->num_errors = parser.num_errors();
+  p_load->done = true;
+}
+
+/******************************************************************************
+* end_async_load
+******************************************************************************/
+static void end_async_load()
+{
+  p_async_load->worker.join();
+  KillTimer( cagdGetWindow(), K_DRAIN_TIMER_ID );
+
+  delete p_async_load;
+  p_async_load = nullptr;
+}
+
+/******************************************************************************
+* drain_async_load
+******************************************************************************/
+// timer callback, registers what the parsing thread has ready so far
+static void CALLBACK drain_async_load( HWND hwnd, UINT msg, UINT_PTR id, DWORD time )
+{
+  AsyncLoad *p_load = p_async_load;
+  std::vector< CurveRecord > ready;
+  bool done;
+
+  if( p_load == nullptr )
+    return;
+
+  {
+    std::lock_guard< std::mutex > lock( p_load->mtx );
+    ready.swap( p_load->ready );
+    done = p_load->done;
+  }
+
+  if( !ready.empty() )
+  {
+    std::vector< Curve * > new_crvs( ready.size() );
+
+    for( size_t i = 0; i < ready.size(); ++i )
+      new_crvs[ i ] = build_curve( ready[ i ] );
+
+    register_crvs( new_crvs );
+    p_load->num_crvs += new_crvs.size();
+    cagdRedraw();
+  }
+
+  if( !done )
+    return;
+
+  report_parse_errors( p_load->first_error, p_load->num_errors );
+  print_load_stats( p_load->num_crvs, p_load->file->size(), p_load->start );
+  end_async_load();
+}
+
+/******************************************************************************
+* load_file_async
+******************************************************************************/
+void load_file_async( const std::string &file_path )
+{
+  cancel_async_load();
+
+  auto p_file = std::make_unique< MappedFile >( file_path );
+
+  if( !p_file->is_mapped() )
+  {
+    // nothing worth a thread, let the synchronous loader report or fall back
+    p_file.reset();
+
+    if( load_mapped_file( file_path ) < get_scene()->curves.size() )
+      cagdRedraw();
+
+    return;
+  }
+
+  p_async_load = new AsyncLoad();
+  p_async_load->file = std::move( p_file );
+  p_async_load->cancel = false;
+  p_async_load->start = std::chrono::steady_clock::now();
+  p_async_load->num_crvs = 0;
+  p_async_load->done = false;
+  p_async_load->num_errors = 0;
+  p_async_load->worker = std::thread( parse_async, p_async_load );
+
+  SetTimer( cagdGetWindow(), K_DRAIN_TIMER_ID, K_DRAIN_TIMER_MS, drain_async_load );
+}
+
+/******************************************************************************
+* cancel_async_load
+******************************************************************************/
+void cancel_async_load()
+{
+  if( p_async_load == nullptr )
+    return;
+
+  // curves registered so far stay, the rest is dropped
+  p_async_load->cancel = true;
+  printf( "Load cancelled after %zu curves\n", p_async_load->num_crvs );
+  end_async_load();
+}
+
+/******************************************************************************
+* is_async_loading
+******************************************************************************/
+bool is_async_loading()
+{
+  return p_async_load != nullptr;
+}
@@ -2,21 +2,30 @@
 #include <fstream>
 #include <string>
 #include <sstream>
-#include <map>
 #include <stdexcept>
 
 #include "vectors.h"
 #include "options.h"
+#include "color.h"
 #include "BSpline.h"
 #include "Bezier.h"
 #include "crv_utils.h"
+#include "crv_visit.h"
+#include "history.h"
+#include "scene.h"
+#include "crv_load.h"
+#include "crv_binary.h"
+#include "text_writer.h"
+#include "itd_import.h"
+#include "journal.h"
+#include "session.h"
+#include "tess_cache.h"
+#include "paged_scene.h"
 #include <algorithm>
 
-std::vector< Curve * > cur_curves;
-std::map< int, Curve * > seg_to_crv;
-std::map< int, Curve * > pnt_to_crv;
-std::map< int, std::tuple< int, int > > ctrl_seg_to_pnts;
-active_ctrl_pt_data active_drag_pt = { K_NOT_USED, { 0, 0 }, true };
+#define K_MAX_ORDER_SPLITS 8
+
+active_ctrl_pt_data active_drag_pt = { K_NOT_USED, K_NOT_USED, { 0, 0 }, true };
 
 void print_error( const std::string &message );
 static inline void ltrim( std::string &str );
@@ -61,6 +70,22 @@ void set_active_pt_id( int id )
   active_drag_pt.active_pt_id = id;
 }
 
+/******************************************************************************
+* get_active_pt_idx
+******************************************************************************/
+int get_active_pt_idx()
+{
+  return active_drag_pt.active_pt_idx;
+}
+
+/******************************************************************************
+* set_active_pt_idx
+******************************************************************************/
+void set_active_pt_idx( int idx )
+{
+  active_drag_pt.active_pt_idx = idx;
+}
+
 /******************************************************************************
 * get_active_pt_last_pos
 ******************************************************************************/
@@ -99,18 +124,57 @@ void set_active_pt_is_first_move( bool value )
 ******************************************************************************/
 void redraw_all_curves()
 {
-  for( auto p_crv : cur_curves )
+  for( auto p_crv : get_scene()->curves )
     p_crv->show_crv();
 
   cagdRedraw();
 }
 
+/******************************************************************************
+* reduce_all_knots
+******************************************************************************/
+size_t reduce_all_knots( double tol )
+{
+  size_t num_removed = 0;
+  size_t num_crvs = 0;
+
+  for( auto p_crv : get_scene()->curves )
+  {
+    if( p_crv->kind_ != CurveType::BSPLINE )
+      continue;
+
+    BSpline *p_bspline = static_cast< BSpline * >( p_crv );
+
+    hist_record( p_bspline );
+
+    int num = p_bspline->removeKnots( tol );
+
+    if( num == 0 )
+      continue;
+
+    num_removed += num;
+    ++num_crvs;
+    p_bspline->show_crv();
+    p_bspline->show_ctrl_poly();
+  }
+
+  hist_commit();
+  cagdRedraw();
+
+  std::string message = "Removed " + std::to_string( num_removed ) +
+                        " knots from " + std::to_string( num_crvs ) + " curves.";
+  cagdSetHelpText( message.c_str() );
+  cagdShowHelp();
+
+  return num_removed;
+}
+
 /******************************************************************************
 * hide_all_ctrl_polys
 ******************************************************************************/
 void hide_all_ctrl_polys()
 {
-  for( auto p_crv : cur_curves )
+  for( auto p_crv : get_scene()->curves )
     p_crv->hide_ctrl_poly();
 
   cagdRedraw();
@@ -121,18 +185,48 @@ void hide_all_ctrl_polys()
 ******************************************************************************/
 void show_all_ctrl_polys()
 {
-  for( auto p_crv : cur_curves )
+  for( auto p_crv : get_scene()->curves )
     p_crv->show_ctrl_poly();
 
   cagdRedraw();
 }
 
+/******************************************************************************
+* set_id_crv
+******************************************************************************/
+static void set_id_crv( std::vector< Curve * > &table, int id, Curve *p_curve )
+{
+  if( id < 0 )
+    return;
+
+  if( ( size_t )id >= table.size() )
+  {
+    if( p_curve == nullptr )
+      return;
+
+    table.resize( id + 1, nullptr );
+  }
+
+  table[ id ] = p_curve;
+}
+
+/******************************************************************************
+* get_id_crv
+******************************************************************************/
+static Curve *get_id_crv( const std::vector< Curve * > &table, int id )
+{
+  if( id < 0 || ( size_t )id >= table.size() )
+    return nullptr;
+
+  return table[ id ];
+}
+
 /******************************************************************************
 * map_seg_to_crv
 ******************************************************************************/
 void map_seg_to_crv( int seg_id, Curve *p_curve )
 {
-  seg_to_crv[ seg_id ] = p_curve;
+  set_id_crv( get_scene()->seg_to_crv, seg_id, p_curve );
 }
 
 /******************************************************************************
@@ -140,15 +234,15 @@ void map_seg_to_crv( int seg_id, Curve *p_curve )
 ******************************************************************************/
 void map_pnt_to_crv( int pnt_id, Curve *p_curve )
 {
-  pnt_to_crv[ pnt_id ] = p_curve;
+  set_id_crv( get_scene()->pnt_to_crv, pnt_id, p_curve );
 }
 
 /******************************************************************************
-* map_ctrl_seg_to_pnts
+* map_ctrl_seg_to_crv
 ******************************************************************************/
-void map_ctrl_seg_to_pnts( int seg_id, int pnt1, int pnt2 )
+void map_ctrl_seg_to_crv( int seg_id, Curve *p_curve )
 {
-  ctrl_seg_to_pnts[ seg_id ] = std::make_tuple( pnt1, pnt2 );
+  set_id_crv( get_scene()->ctrl_seg_to_crv, seg_id, p_curve );
 }
 
 /******************************************************************************
@@ -156,15 +250,15 @@ void map_ctrl_seg_to_pnts( int seg_id, int pnt1, int pnt2 )
 ******************************************************************************/
 void erase_pnt_to_crv( int pnt_id )
 {
-  pnt_to_crv.erase( pnt_id );
+  set_id_crv( get_scene()->pnt_to_crv, pnt_id, nullptr );
 }
 
 /******************************************************************************
-* erase_ctrl_seg_to_pnts
+* erase_ctrl_seg_to_crv
 ******************************************************************************/
-void erase_ctrl_seg_to_pnts( int seg_id )
+void erase_ctrl_seg_to_crv( int seg_id )
 {
-  ctrl_seg_to_pnts.erase( seg_id );
+  set_id_crv( get_scene()->ctrl_seg_to_crv, seg_id, nullptr );
 }
 
 /******************************************************************************
@@ -172,7 +266,7 @@ void erase_ctrl_seg_to_pnts( int seg_id )
 ******************************************************************************/
 void erase_seg_to_crv( int seg_id )
 {
-  seg_to_crv.erase( seg_id );
+  set_id_crv( get_scene()->seg_to_crv, seg_id, nullptr );
 }
 
 /******************************************************************************
@@ -180,21 +274,15 @@ void erase_seg_to_crv( int seg_id )
 ******************************************************************************/
 Curve *get_pnt_crv( int pnt_id )
 {
-  if( pnt_to_crv.find( pnt_id ) != pnt_to_crv.end() )
-    return pnt_to_crv[ pnt_id ];
-  else
-    return nullptr;
+  return get_id_crv( get_scene()->pnt_to_crv, pnt_id );
 }
 
 /******************************************************************************
-* get_ctrl_seg_pnts
+* get_ctrl_seg_crv
 ******************************************************************************/
-std::tuple< int, int > get_ctrl_seg_pnts( int seg_id )
+Curve *get_ctrl_seg_crv( int seg_id )
 {
-  if( ctrl_seg_to_pnts.find( seg_id ) != ctrl_seg_to_pnts.end() )
-    return ctrl_seg_to_pnts[ seg_id ];
-  else
-    return std::make_tuple( K_NOT_USED, K_NOT_USED );
+  return get_id_crv( get_scene()->ctrl_seg_to_crv, seg_id );
 }
 
 /******************************************************************************
@@ -207,7 +295,10 @@ void update_weight_callback( int pt_id, int pnt_idx, double val )
 
   if( p_crv != nullptr )
   {
+    hist_record( p_crv );
+    hist_record_edit( p_crv, EditOp::SET_WEIGHT, pnt_idx, val );
     p_crv->update_weight( pnt_idx, val );
+    hist_commit();
     p_crv->show_crv();
     cagdRedraw();
   }
@@ -218,17 +309,10 @@ void update_weight_callback( int pt_id, int pnt_idx, double val )
 ******************************************************************************/
 CurveType get_crv_type( Curve *p_crv )
 {
-  BSpline *p_bspline = dynamic_cast< BSpline * >( p_crv );
-
-  if( p_bspline != nullptr )
-    return CurveType::BSPLINE;
-
-  Bezier *p_bezier = dynamic_cast< Bezier * >( p_crv );
-
-  if( p_bezier != nullptr )
-    return CurveType::BEZIER;
-  else
+  if( p_crv->kind_ == CurveType::NONE )
     throw std::runtime_error( "bad map for seg id to crv" );
+
+  return p_crv->kind_;
 }
 
 /******************************************************************************
@@ -241,17 +325,78 @@ CurveType get_crv( int seg_id, Curve **rp_crv )
   if( *rp_crv == nullptr )
     return CurveType::NONE;
 
-  BSpline *p_bspline = dynamic_cast< BSpline * >( *rp_crv );
+  return get_crv_type( *rp_crv );
+}
 
-  if( p_bspline != nullptr )
-    return CurveType::BSPLINE;
+/******************************************************************************
+* connect_crvs
+******************************************************************************/
+static void connect_crvs( Curve *p_crv, const Bezier *p_other, ConnType conn )
+{
+  switch( conn )
+  {
+    case ConnType::C0:
+      p_crv->connectC0_bezier( p_other );
+      break;
+    case ConnType::C1:
+      p_crv->connectC1_bezier( p_other );
+      break;
+    case ConnType::G1:
+      p_crv->connectG1_bezier( p_other );
+      break;
+    default:
+      throw std::runtime_error( "invalid conn type" );
+  }
+}
 
-  Bezier *p_bezier = dynamic_cast< Bezier * >( *rp_crv );
+/******************************************************************************
+* connect_crvs
+******************************************************************************/
+static void connect_crvs( Curve *p_crv, const BSpline *p_other, ConnType conn )
+{
+  switch( conn )
+  {
+    case ConnType::C0:
+      p_crv->connectC0_bspline( p_other );
+      break;
+    case ConnType::C1:
+      p_crv->connectC1_bspline( p_other );
+      break;
+    case ConnType::G1:
+      p_crv->connectG1_bspline( p_other );
+      break;
+    default:
+      throw std::runtime_error( "invalid conn type" );
+  }
+}
 
-  if( p_bezier != nullptr )
-    return CurveType::BEZIER;
-  else
-    throw std::runtime_error( "bad map for seg id to crv" );
+/******************************************************************************
+* get_crv_knots
+******************************************************************************/
+static double_vec get_crv_knots( const Bezier *p_bezier )
+{
+  double_vec knots( p_bezier->ctrl_pnts_.size() + p_bezier->order_, 0.0 );
+  std::fill( knots.begin() + p_bezier->ctrl_pnts_.size(), knots.end(), 1.0 );
+  return knots;
+}
+
+/******************************************************************************
+* get_crv_knots
+******************************************************************************/
+static double_vec get_crv_knots( const BSpline *p_bspline )
+{
+  return p_bspline->knots_;
+}
+
+/******************************************************************************
+* get_crv_knots
+******************************************************************************/
+static double_vec get_crv_knots( const Curve *p_crv )
+{
+  return visit_crv( p_crv, []( auto p_concrete )
+                    {
+                      return get_crv_knots( p_concrete );
+                    } );
 }
 
 /******************************************************************************
@@ -266,58 +411,41 @@ bool connect_crv_callback( int seg_id_1, int seg_id_2, ConnType conn )
     CurveType crv_type_1 = get_crv( seg_id_1, &p_crv_1 );
     CurveType crv_type_2 = get_crv( seg_id_2, &p_crv_2 );
 
-    if( crv_type_2 == CurveType::NONE )
+    if( crv_type_1 == CurveType::NONE || crv_type_2 == CurveType::NONE )
       return false;
 
     /*createBSplineFromCurves( p_crv_1, p_crv_2, conn );
     cagdRedraw();
     return true;*/
-    switch( conn )
-    {
-      case ConnType::C0:
-      {
-        if( crv_type_2 == CurveType::BSPLINE )
-          p_crv_1->connectC0_bspline( ( BSpline * )p_crv_2 );
-        else if( crv_type_2 == CurveType::BEZIER )
-          p_crv_1->connectC0_bezier( ( Bezier * )p_crv_2 );
-        else
-        {
-          throw std::runtime_error( "invalid crv type" );
-        }
-        break;
-      }
+    hist_record( p_crv_1 );
+    hist_record( p_crv_2 );
 
-      case ConnType::C1:
-      {
-        if( crv_type_2 == CurveType::BSPLINE )
-          p_crv_1->connectC1_bspline( ( BSpline * )p_crv_2 );
-        else if( crv_type_2 == CurveType::BEZIER )
-          p_crv_1->connectC1_bezier( ( Bezier * )p_crv_2 );
-        else
-        {
-          throw std::runtime_error( "invalid crv type" );
-        }
-        break;
-      }
+    // the continuity conditions assume equal orders, so the lower order curve
+    // is elevated first, which keeps its shape
+    int order = max( p_crv_1->order_, p_crv_2->order_ );
+    Curve *p_lower = p_crv_1->order_ < order ? p_crv_1 : p_crv_2;
 
-      case ConnType::G1:
-      {
-        if( crv_type_2 == CurveType::BSPLINE )
-          p_crv_1->connectG1_bspline( ( BSpline * )p_crv_2 );
-        else if( crv_type_2 == CurveType::BEZIER )
-          p_crv_1->connectG1_bezier( ( Bezier * )p_crv_2 );
-        else
-        {
-          throw std::runtime_error( "invalid crv type" );
-        }
-        break;
-      }
-      default:
+    if( p_lower->order_ < order )
+    {
+      if( !p_lower->elevateDegree( order - p_lower->order_ ) )
       {
-        throw std::runtime_error( "invalid conn type" );
+        // a failed elevation leaves the curve as it was, nothing is recorded
+        hist_commit();
+        print_error( "The curves cannot be brought to the same order." );
+        return false;
       }
+
+      p_lower->show_ctrl_poly();
+      p_lower->show_crv();
     }
 
+    visit_crv_pair( p_crv_1, p_crv_2, [ & ]( auto p_crv, auto p_other )
+                    {
+                      connect_crvs( p_crv, p_other, conn );
+                    } );
+
+    hist_commit();
+
     p_crv_1->show_ctrl_poly();
     p_crv_1->show_crv();
     cagdRedraw();
@@ -353,7 +481,7 @@ BSpline *createBSplineFromBezierCurves( Bezier *bezier1, Bezier *bezier2 )
 
   int order = bezier1->order_;
 
-  std::vector<double> knots;
+  double_vec knots;
   int n = combined_ctrl_pnts.size();
 
   for( int i = 0; i < order; ++i ) knots.push_back( 0.0 );
@@ -380,7 +508,7 @@ BSpline *createBSplineFromBSplines( BSpline *bspline1, BSpline *bspline2 )
 
   int order = bspline1->order_;
 
-  std::vector<double> knots;
+  double_vec knots;
   int n = combined_ctrl_pnts.size();
 
   for( int i = 0; i < order; ++i ) knots.push_back( 0.0 );
@@ -427,30 +555,8 @@ std::vector<double> constructKnotVector( const Curve *crv1, const Curve *crv2, C
   if( crv1 == nullptr || crv2 == nullptr )
     throw std::runtime_error( "bad crvs to connect" );
 
-  std::vector<double> knots1;
-  std::vector<double> knots2;
-
-  // Extract knots from the first curve
-  if( const Bezier *b1 = dynamic_cast< const Bezier * >( crv1 ) )
-  {
-    knots1.resize( b1->ctrl_pnts_.size() + b1->order_, 0.0 );
-    std::fill( knots1.begin() + b1->ctrl_pnts_.size(), knots1.end(), 1.0 );
-  }
-  else if( const BSpline *bs1 = dynamic_cast< const BSpline * >( crv1 ) )
-  {
-    knots1 = bs1->knots_;
-  }
-
-  // Extract knots from the second curve
-  if( const Bezier *b2 = dynamic_cast< const Bezier * >( crv2 ) )
-  {
-    knots2.resize( b2->ctrl_pnts_.size() + b2->order_, 0.0 );
-    std::fill( knots2.begin() + b2->ctrl_pnts_.size(), knots2.end(), 1.0 );
-  }
-  else if( const BSpline *bs2 = dynamic_cast< const BSpline * >( crv2 ) )
-  {
-    knots2 = bs2->knots_;
-  }
+  double_vec knots1 = get_crv_knots( crv1 );
+  double_vec knots2 = get_crv_knots( crv2 );
 
   double maxKnot1 = *std::max_element( knots1.begin(), knots1.end() );
 
@@ -530,33 +636,11 @@ BSpline *createBSplineFromCurves( Curve *crv1, Curve *crv2, ConnType continuityT
   if( !crv1 || !crv2 )
     throw std::invalid_argument( "Curve pointers must not be null" );
 
-  std::vector<double> knots1;
-  std::vector<double> knots2;
-
-  // Extract knots from the first curve
-  if( const Bezier *b1 = dynamic_cast< const Bezier * >( crv1 ) )
-  {
-    knots1.resize( b1->ctrl_pnts_.size() + b1->order_, 0.0 );
-    std::fill( knots1.begin() + b1->ctrl_pnts_.size(), knots1.end(), 1.0 );
-  }
-  else if( const BSpline *bs1 = dynamic_cast< const BSpline * >( crv1 ) )
-  {
-    knots1 = bs1->knots_;
-  }
-
-  // Extract knots from the second curve
-  if( const Bezier *b2 = dynamic_cast< const Bezier * >( crv2 ) )
-  {
-    knots2.resize( b2->ctrl_pnts_.size() + b2->order_, 0.0 );
-    std::fill( knots2.begin() + b2->ctrl_pnts_.size(), knots2.end(), 1.0 );
-  }
-  else if( const BSpline *bs2 = dynamic_cast< const BSpline * >( crv2 ) )
-  {
-    knots2 = bs2->knots_;
-  }
+  double_vec knots1 = get_crv_knots( crv1 );
+  double_vec knots2 = get_crv_knots( crv2 );
 
   // Prepare control points for the new B-spline
-  std::vector<CAGD_POINT> combinedCtrlPoints = crv1->ctrl_pnts_;
+  point_vec combinedCtrlPoints = crv1->ctrl_pnts_;
   combinedCtrlPoints.insert( combinedCtrlPoints.end(), crv2->ctrl_pnts_.begin(), crv2->ctrl_pnts_.end() );
 
   // Adjust control points for continuity
@@ -600,6 +684,74 @@ BSpline *createBSplineFromCurves( Curve *crv1, Curve *crv2, ConnType continuityT
   return newBSpline;
 }
 
+/******************************************************************************
+* lower_crv_order
+******************************************************************************/
+BSpline *lower_crv_order( Curve *p_crv, int order, double tol )
+{
+  if( order < 2 || p_crv->order_ <= order || p_crv->is_miss_ctrl_pnts() )
+    return nullptr;
+
+  // every reduction step gets its share of what is left of tol, when a step
+  // does not fit all spans of the copy are halved and it starts over
+  BSpline split( p_crv->order_, p_crv->ctrl_pnts_, get_crv_knots( p_crv ) );
+  BSpline *p_lower = nullptr;
+  double left = tol;
+
+  split.updateUniqueKnotsAndMultiplicity();
+
+  for( int num_splits = 0; num_splits <= K_MAX_ORDER_SPLITS; ++num_splits )
+  {
+    p_lower = new BSpline( split.order_, split.ctrl_pnts_, split.knots_ );
+    p_lower->updateUniqueKnotsAndMultiplicity();
+    left = tol;
+
+    bool is_ok = true;
+
+    while( is_ok && p_lower->order_ > order )
+    {
+      double err;
+
+      is_ok = p_lower->reduceDegree( left / ( p_lower->order_ - order ), err );
+      left -= err;
+    }
+
+    if( is_ok )
+      break;
+
+    delete p_lower;
+    p_lower = nullptr;
+
+    int p = split.order_ - 1;
+    double_vec middles;
+
+    for( size_t i = p; i < split.ctrl_pnts_.size(); ++i )
+    {
+      if( split.knots_[ i + 1 ] > split.knots_[ i ] )
+        middles.push_back( 0.5 * ( split.knots_[ i ] + split.knots_[ i + 1 ] ) );
+    }
+
+    if( !split.refineKnotVector( middles ) )
+      break;
+  }
+
+  if( p_lower == nullptr )
+    return nullptr;
+
+  p_lower->removeKnots( left );
+  p_lower->color_[ 0 ] = p_crv->color_[ 0 ];
+  p_lower->color_[ 1 ] = p_crv->color_[ 1 ];
+  p_lower->color_[ 2 ] = p_crv->color_[ 2 ];
+
+  hist_record( p_crv );
+  free_crv( p_crv );
+  hist_record( p_lower );
+  register_crv( p_lower );
+  hist_commit();
+
+  return p_lower;
+}
+
 /******************************************************************************
 * make_open_callback
 ******************************************************************************/
@@ -707,10 +859,14 @@ void rmv_knot_callback( int seg_id, int knot_idx )
       throw std::runtime_error( "wrong crv type" );
     }
 
+    hist_record( p_crv );
+    hist_record_edit( p_crv, EditOp::REMOVE_KNOT, knot_idx, 0.0 );
     ( ( BSpline * )p_crv )->rmvKnot( knot_idx );
+    hist_commit();
   }
   catch( const std::runtime_error &err )
   {
+    hist_commit(); // drops the edit that did not happen
     throw err;
   }
 }
@@ -718,22 +874,14 @@ void rmv_knot_callback( int seg_id, int knot_idx )
 /******************************************************************************
 * update_ctrl_pnt_callback
 ******************************************************************************/
-void update_ctrl_pnt_callback( int pnt_id, double new_x, double new_y )
+Curve *update_ctrl_pnt_callback( int pnt_id, int pnt_idx, double new_x, double new_y )
 {
   Curve *p_crv = get_pnt_crv( pnt_id );
 
   if( p_crv != nullptr )
-  {
-    int pnt_idx = p_crv->get_pnt_id_idx( pnt_id );
-
-    if( pnt_idx == K_NOT_USED )
-    {
-      throw std::runtime_error( "bad pnt id" );
-    }
+    p_crv->move_ctrl_pnt( pnt_idx, new_x, new_y );
 
-    p_crv->ctrl_pnts_[ pnt_idx ].x = new_x;
-    p_crv->ctrl_pnts_[ pnt_idx ].y = new_y;
-  }
+  return p_crv;
 }
 
 /******************************************************************************
@@ -746,17 +894,7 @@ void save_curve( int seg_crv, int dummy2, void *p_data )
   Curve *p_crv = nullptr;
   get_crv( seg_crv, &p_crv );
 
-  std::ofstream ofs( file_str );
-
-  if( !ofs )
-  {
-    print_error( "Error opening file for writing" );
-    return;
-  }
-
-  p_crv->dump( ofs );
-
-  ofs.close();
+  write_crvs_text( file_str, { p_crv } );
 }
 
 /******************************************************************************
@@ -767,18 +905,35 @@ void save_all_curves( int dummy1, int dummy2, void *p_data )
   char *file_path = ( char * )p_data;
   std::string file_str = file_path;
 
-  std::ofstream ofs( file_str );
-
-  if( !ofs )
+  // only the curves in view are in memory, a save would drop the rest
+  if( paged_scene_is_open() )
   {
-    print_error( "Error opening file for writing" );
+    print_error( "A paged file is open and only the curves in view\n"
+                 "are loaded, so the scene cannot be saved." );
     return;
   }
 
-  for( size_t i = 0; i < cur_curves.size(); ++i )
-    cur_curves[ i ]->dump( ofs );
+  if( is_session_file_path( file_str ) )
+    save_session( file_str );
+  else if( is_binary_file_path( file_str ) )
+    save_binary_file( file_str, get_pack_saves() ? get_pack_tol() : 0.0 );
+  else
+    save_text_file( file_str );
+}
+
+/******************************************************************************
+* save_text_file
+******************************************************************************/
+bool save_text_file( const std::string &file_path )
+{
+  std::vector< const Curve * > crvs;
+
+  crvs.reserve( get_scene()->curves.size() );
 
-  ofs.close();
+  for( auto p_crv : get_scene()->curves )
+    crvs.push_back( p_crv );
+
+  return write_crvs_text( file_path, crvs );
 }
 
 /******************************************************************************
@@ -788,9 +943,38 @@ void load_curves( int dummy1, int dummy2, void *p_data )
 {
   char *file_path = ( char * )p_data;
   std::string file_str = file_path;
-  size_t first_new_idx = parse_file( file_str );
 
-  if( first_new_idx < cur_curves.size() )
+  if( is_itd_file_path( file_str ) )
+  {
+    if( import_itd_file( file_str ) > 0 )
+      cagdRedraw();
+
+    return;
+  }
+
+  if( is_session_file_path( file_str ) )
+  {
+    load_session( file_str );
+    return;
+  }
+
+  // files too large to load whole are browsed a view at a time
+  if( !journal_is_open() && is_paged_file_path( file_str ) )
+  {
+    paged_scene_open( file_str );
+    return;
+  }
+
+  // text files are parsed in the background and drawn as they come in
+  if( !is_binary_file_path( file_str ) )
+  {
+    load_file_async( file_str );
+    return;
+  }
+
+  size_t first_new_idx = load_binary_file( file_str );
+
+  if( first_new_idx < get_scene()->curves.size() )
     cagdRedraw();
 }
 
@@ -799,10 +983,7 @@ void load_curves( int dummy1, int dummy2, void *p_data )
 ******************************************************************************/
 Curve *get_seg_crv( int seg_id )
 {
-  if( seg_to_crv.find( seg_id ) != seg_to_crv.end() )
-    return seg_to_crv[ seg_id ];
-  else
-    return nullptr;
+  return get_id_crv( get_scene()->seg_to_crv, seg_id );
 }
 
 /******************************************************************************
@@ -890,7 +1071,124 @@ void register_crv( Curve *p_crv )
     p_crv->show_crv();
 
   p_crv->show_ctrl_poly();
-  cur_curves.push_back( p_crv );
+  p_crv->handle_ = get_scene()->curves.insert( p_crv );
+  hist_track( p_crv );
+}
+
+/******************************************************************************
+* add_polylines
+******************************************************************************/
+static void add_polylines( std::vector< point_vec > &pnts,
+                           std::vector< UINT > &ids,
+                           bool is_pnt_set )
+{
+  size_t num = pnts.size();
+  std::vector< const CAGD_POINT * > where( num );
+  std::vector< UINT > lengths( num );
+
+  for( size_t i = 0; i < num; ++i )
+  {
+    where[ i ] = pnts[ i ].data();
+    lengths[ i ] = ( UINT )pnts[ i ].size();
+  }
+
+  ids.resize( num );
+
+  if( is_pnt_set )
+    cagdAddPointSets( where.data(), lengths.data(), ( UINT )num, ids.data() );
+  else
+    cagdAddPolylines( where.data(), lengths.data(), ( UINT )num, ids.data() );
+}
+
+/******************************************************************************
+* register_crvs
+******************************************************************************/
+void register_crvs( const std::vector< Curve * > &crvs )
+{
+  std::vector< point_vec > crv_pnts( crvs.size() );
+
+  for( size_t i = 0; i < crvs.size(); ++i )
+  {
+    if( crvs[ i ]->ctrl_pnts_.size() > 1 )
+      tess_cache_sample( crvs[ i ], crv_pnts[ i ] );
+  }
+
+  register_sampled_crvs( crvs, crv_pnts );
+}
+
+/******************************************************************************
+* register_sampled_crvs
+******************************************************************************/
+void register_sampled_crvs( const std::vector< Curve * > &crvs,
+                            std::vector< point_vec > &crv_pnts )
+{
+  size_t num = crvs.size();
+  bool show_polys = !get_hide_ctrl_polys();
+  std::vector< point_vec > poly_pnts( num );
+  std::vector< UINT > ids;
+
+  for( size_t i = 0; i < num; ++i )
+  {
+    crvs[ i ]->update_eval_cache();
+
+    if( show_polys )
+      crvs[ i ]->get_ctrl_poly_pnts( poly_pnts[ i ] );
+  }
+
+  add_polylines( crv_pnts, ids, false );
+
+  for( size_t i = 0; i < num; ++i )
+  {
+    if( ids[ i ] == 0 )
+      continue;
+
+    GLubyte *color = crvs[ i ]->color_;
+    cagdSetSegmentColor( ids[ i ], color[ 0 ], color[ 1 ], color[ 2 ] );
+    crvs[ i ]->seg_ids_.push_back( ids[ i ] );
+    map_seg_to_crv( ids[ i ], crvs[ i ] );
+  }
+
+  if( show_polys )
+  {
+    set_norm_color();
+    add_polylines( poly_pnts, ids, true );
+
+    for( size_t i = 0; i < num; ++i )
+    {
+      if( ids[ i ] == 0 )
+        continue;
+
+      crvs[ i ]->pnt_seg_id_ = ids[ i ];
+      map_pnt_to_crv( ids[ i ], crvs[ i ] );
+    }
+
+    set_bi_color();
+    add_polylines( poly_pnts, ids, false );
+
+    for( size_t i = 0; i < num; ++i )
+    {
+      if( ids[ i ] == 0 )
+        continue;
+
+      crvs[ i ]->poly_seg_id_ = ids[ i ];
+      map_ctrl_seg_to_crv( ids[ i ], crvs[ i ] );
+    }
+
+    set_default_color();
+  }
+
+  SlotMap< Curve * > &cur_curves = get_scene()->curves;
+
+  cur_curves.reserve( cur_curves.size() + num );
+
+  for( auto p_crv : crvs )
+  {
+    p_crv->handle_ = cur_curves.insert( p_crv );
+    hist_track( p_crv );
+    journal_put_crv( p_crv );
+  }
+
+  journal_end_op();
 }
 
 /******************************************************************************
@@ -903,6 +1201,7 @@ void free_crv( Curve *p_crv )
     remove_crv_data( p_crv );
 
     erase_crv_from_cur_crvs( p_crv );
+    hist_untrack( p_crv );
 
     delete p_crv;
     p_crv = nullptr;
@@ -922,18 +1221,8 @@ void remove_crv_data( Curve *p_crv )
       cagdFreeSegment( p_crv->seg_ids_[0] );
     }
 
-    for( size_t i = 0; i < p_crv->poly_seg_ids_.size(); ++i )
-    {
-      erase_seg_to_crv( p_crv->poly_seg_ids_[i] );
-      cagdFreeSegment( p_crv->poly_seg_ids_[i] );
-    }
-
-    for( size_t i = 0; i < p_crv->pnt_ids_.size(); ++i )
-    {
-      erase_pnt_to_crv( p_crv->pnt_ids_[i] );
-      erase_ctrl_seg_to_pnts( p_crv->pnt_ids_[i] );
-      cagdFreeSegment( p_crv->pnt_ids_[i] );
-    }
+    p_crv->clean_ctrl_poly();
+    p_crv->clean_ctrl_pnts();
   }
 }
 
@@ -942,10 +1231,8 @@ void remove_crv_data( Curve *p_crv )
 ******************************************************************************/
 void erase_crv_from_cur_crvs( Curve *p_curve )
 {
-  auto it = std::find( cur_curves.begin(), cur_curves.end(), p_curve );
-
-  if( it != cur_curves.end() )
-    cur_curves.erase( it );
+  get_scene()->curves.erase( p_curve->handle_ );
+  p_curve->handle_ = K_NO_HANDLE;
 }
 
 /******************************************************************************
@@ -953,16 +1240,15 @@ void erase_crv_from_cur_crvs( Curve *p_curve )
 ******************************************************************************/
 void clean_current_curves()
 {
-  auto it = cur_curves.begin();
-  while( it != cur_curves.end() )
-  {
-    remove_crv_data( *it );
-    delete *it;
-    *it = nullptr;
-    it = cur_curves.erase( it );
-  }
+  Scene *p_scene = get_scene();
+
+  // curves are destroyed before the pool is dropped as a whole, so a curve or
+  // vector that did not come from the pool is freed as well
+  for( auto p_crv : p_scene->curves )
+    delete p_crv;
 
-  cur_curves.clear();
+  p_scene->curves.clear();
+  release_crv_resource();
 }
 
 /******************************************************************************
@@ -970,8 +1256,19 @@ void clean_current_curves()
 ******************************************************************************/
 void clean_all_curves()
 {
-  clean_current_curves();
+  Scene *p_scene = get_scene();
+
+  if( paged_scene_is_open() )
+    paged_scene_close();
+
+  hist_clear();
   cagdFreeAllSegments();
+  p_scene->seg_to_crv.clear();
+  p_scene->pnt_to_crv.clear();
+  p_scene->ctrl_seg_to_crv.clear();
+  clean_current_curves();
+  journal_put_clear();
+  journal_end_op();
   cagdRedraw();
 }
 
@@ -1168,7 +1465,8 @@ bool add_control_points( std::ifstream &file, Curve *curve )
 ******************************************************************************/
 size_t parse_file( const std::string &filePath )
 {
-  size_t first_new_idx = cur_curves.size();
+  size_t first_new_idx = get_scene()->curves.size();
+  std::vector< Curve * > new_crvs;
 
   std::ifstream file( filePath, std::ios::binary );
   if( !file.is_open() )
@@ -1218,9 +1516,10 @@ size_t parse_file( const std::string &filePath )
     if( IS_DEBUG )
       curve->print();
 
-    register_crv( curve );
+    new_crvs.push_back( curve );
   }
 
   file.close();
+  register_crvs( new_crvs );
   return first_new_idx;
 }
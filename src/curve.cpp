@@ -2,16 +2,27 @@
 #include "crv_utils.h"
 #include "options.h"
 #include "color.h"
+#include "text_writer.h"
 #include <vector>
 #include <string>
 #include <fstream>
 #include <iostream>
-#include <iomanip>
+#include <atomic>
+
+#define K_CRV_HEADER_SIZE alignof( std::max_align_t ) // the pool of the curve
+
+static std::atomic< unsigned int > next_crv_uid = 1; // shared by all scenes
 
 /******************************************************************************
 * Curve::Curve
 ******************************************************************************/
-Curve::Curve() : order_( 0 )
+Curve::Curve( CurveType kind ) :
+  order_( 0 ),
+  pnt_seg_id_( K_NOT_USED ),
+  poly_seg_id_( K_NOT_USED ),
+  handle_( K_NO_HANDLE ),
+  kind_( kind ),
+  uid_( next_crv_uid++ )
 {
   const unsigned char *curve_color = get_curve_color();
 
@@ -23,9 +34,14 @@ Curve::Curve() : order_( 0 )
 /******************************************************************************
 * Curve::Curve
 ******************************************************************************/
-Curve::Curve( int order, point_vec ctrl_pnts ) :
+Curve::Curve( CurveType kind, int order, point_vec ctrl_pnts ) :
   order_( order ),
-  ctrl_pnts_( ctrl_pnts )
+  ctrl_pnts_( ctrl_pnts, get_crv_resource() ),
+  pnt_seg_id_( K_NOT_USED ),
+  poly_seg_id_( K_NOT_USED ),
+  handle_( K_NO_HANDLE ),
+  kind_( kind ),
+  uid_( next_crv_uid++ )
 {
   const unsigned char *curve_color = get_curve_color();
 
@@ -34,44 +50,74 @@ Curve::Curve( int order, point_vec ctrl_pnts ) :
   color_[ 2 ] = curve_color[ 2 ];
 }
 
+/******************************************************************************
+* Curve::operator new
+******************************************************************************/
+// the block starts with the pool it came from, a curve is freed into its own
+// pool whichever scene is selected by then
+void *Curve::operator new( size_t size )
+{
+  std::pmr::memory_resource *p_res = get_crv_resource();
+  char *p_block = ( char * )p_res->allocate( size + K_CRV_HEADER_SIZE,
+                                             alignof( std::max_align_t ) );
+
+  *( std::pmr::memory_resource ** )p_block = p_res;
+  return p_block + K_CRV_HEADER_SIZE;
+}
+
+/******************************************************************************
+* Curve::operator delete
+******************************************************************************/
+void Curve::operator delete( void *p_mem, size_t size )
+{
+  char *p_block = ( char * )p_mem - K_CRV_HEADER_SIZE;
+  std::pmr::memory_resource *p_res = *( std::pmr::memory_resource ** )p_block;
+
+  p_res->deallocate( p_block, size + K_CRV_HEADER_SIZE, alignof( std::max_align_t ) );
+}
+
 /******************************************************************************
 * Curve::dump
 ******************************************************************************/
-void Curve::dump( std::ofstream &ofs ) const
+void Curve::dump( TextBuffer &buf ) const
 {
-  dumpOrder( ofs );
-  dumpControlPoints( ofs );
+  dumpOrder( buf );
+  dumpControlPoints( buf );
 }
 
 /******************************************************************************
 * Curve::dumpOrder
 ******************************************************************************/
-void Curve::dumpOrder( std::ofstream &ofs ) const
+void Curve::dumpOrder( TextBuffer &buf ) const
 {
-  ofs << order_ << "\n";
+  buf.put_int( order_ );
+  buf.put( '\n' );
 }
 
 /******************************************************************************
 * Curve::dumpControlPoints
 ******************************************************************************/
-void Curve::dumpControlPoints( std::ofstream &ofs ) const
+void Curve::dumpControlPoints( TextBuffer &buf ) const
 {
   for( auto point : ctrl_pnts_ )
   {
     point.x *= point.z;
     point.y *= point.z;
-    dumpPoint( ofs, point );
-    ofs << "\n";
+    dumpPoint( buf, point );
+    buf.put( '\n' );
   }
 }
 
 /******************************************************************************
 * Curve::dumpPoint
 ******************************************************************************/
-void Curve::dumpPoint( std::ofstream &ofs, const CAGD_POINT &point ) const
+void Curve::dumpPoint( TextBuffer &buf, const CAGD_POINT &point ) const
 {
-  ofs << std::fixed << std::setprecision( 6 ) << point.x << "\t"
-    << point.y << "\t" << point.z;
+  buf.put_double( point.x );
+  buf.put( '\t' );
+  buf.put_double( point.y );
+  buf.put( '\t' );
+  buf.put_double( point.z );
 }
 
 /******************************************************************************
@@ -108,9 +154,6 @@ void Curve::connect_tangents( const Curve *other, bool is_g1 )
 ******************************************************************************/
 void Curve::rmv_ctrl_pnt( int idx )
 {
-  erase_pnt_to_crv( pnt_ids_[ idx ] );
-  cagdFreeSegment( pnt_ids_[ idx ] );
-  pnt_ids_.erase( pnt_ids_.begin() + idx );
   ctrl_pnts_.erase( ctrl_pnts_.begin() + idx );
 }
 
@@ -121,14 +164,6 @@ void Curve::add_ctrl_pnt( CAGD_POINT &ctrl_pnt, int idx )
 {
   ctrl_pnt.z = 1.0;
 
-  set_norm_color();
-  int pnt_id = cagdAddPoint( &ctrl_pnt );
-  if( get_hide_ctrl_polys() )
-    cagdHideSegment( pnt_id );
-
-  map_pnt_to_crv( pnt_id, this );
-
-  pnt_ids_.insert( pnt_ids_.begin() + idx, pnt_id );
   ctrl_pnts_.insert( ctrl_pnts_.begin() + idx, ctrl_pnt );
 }
 
@@ -155,103 +190,104 @@ void Curve::print() const
 ******************************************************************************/
 void Curve::clean_ctrl_poly()
 {
-  for( size_t i = 0; i < poly_seg_ids_.size(); ++i )
+  if( poly_seg_id_ != K_NOT_USED )
   {
-    erase_ctrl_seg_to_pnts( poly_seg_ids_[ i ] );
-    erase_ctrl_seg_to_pnts( poly_seg_ids_[ i ] );
-    cagdFreeSegment( poly_seg_ids_[ i ] );
+    erase_ctrl_seg_to_crv( poly_seg_id_ );
+    cagdFreeSegment( poly_seg_id_ );
   }
 
-  poly_seg_ids_.clear();
+  poly_seg_id_ = K_NOT_USED;
 }
 
 /******************************************************************************
-* Curve::hide_ctrl_poly
+* Curve::clean_ctrl_pnts
 ******************************************************************************/
-void Curve::hide_ctrl_poly()
+void Curve::clean_ctrl_pnts()
 {
-  for( auto seg_id : poly_seg_ids_ )
-    cagdHideSegment( seg_id );
+  if( pnt_seg_id_ != K_NOT_USED )
+  {
+    erase_pnt_to_crv( pnt_seg_id_ );
+    cagdFreeSegment( pnt_seg_id_ );
+  }
 
-  for( auto pt_id : pnt_ids_ )
-    cagdHideSegment( pt_id );
+  pnt_seg_id_ = K_NOT_USED;
 }
 
 /******************************************************************************
-* Curve::show_ctrl_poly
+* Curve::hide_ctrl_poly
 ******************************************************************************/
-void Curve::show_ctrl_poly()
+void Curve::hide_ctrl_poly()
 {
-  if( get_hide_ctrl_polys() )
-    return;
+  if( poly_seg_id_ != K_NOT_USED )
+    cagdHideSegment( poly_seg_id_ );
 
-  clean_ctrl_poly();
+  if( pnt_seg_id_ != K_NOT_USED )
+    cagdHideSegment( pnt_seg_id_ );
+}
 
+/******************************************************************************
+* Curve::get_ctrl_poly_pnts
+******************************************************************************/
+bool Curve::get_ctrl_poly_pnts( point_vec &pnts ) const
+{
   size_t cur_pnts_num = ctrl_pnts_.size();
 
-  if( cur_pnts_num > 0 )
-  {
-    CAGD_POINT prev_pnt = { ctrl_pnts_[ 0 ].x, ctrl_pnts_[ 0 ].y, 0.0 };
-    CAGD_POINT cur_pnt;
+  pnts.resize( cur_pnts_num );
 
-    if( pnt_ids_.size() > 0 )
-    {
-      set_norm_color();
-      cagdReusePoint( pnt_ids_[ 0 ], &prev_pnt );
-      cagdShowSegment( pnt_ids_[0] );
-    }
-    else
-    {
-      set_norm_color();
-      int pnt_id = cagdAddPoint( &prev_pnt );
-      pnt_ids_.push_back( pnt_id );
-      map_pnt_to_crv( pnt_id, this );
-    }
+  for( size_t i = 0; i < cur_pnts_num; ++i )
+    pnts[ i ] = { ctrl_pnts_[ i ].x, ctrl_pnts_[ i ].y, 0.0 };
 
-    for( size_t i = 1; i < cur_pnts_num; ++i )
-    {
-      cur_pnt = { ctrl_pnts_[ i ].x, ctrl_pnts_[ i ].y, 0.0 };
-      CAGD_POINT pnts[ 2 ] = { prev_pnt, cur_pnt };
-      set_norm_color();
+  return true;
+}
+
+/******************************************************************************
+* Curve::show_ctrl_poly
+******************************************************************************/
+void Curve::show_ctrl_poly()
+{
+  if( get_hide_ctrl_polys() )
+    return;
 
-      int pnt_id = K_NOT_USED;
+  point_vec poly_pnts;
 
-      if( i < pnt_ids_.size() )
-      {
-        pnt_id = pnt_ids_[ i ];
-        cagdReusePoint( pnt_ids_[ i ], &cur_pnt );
-        cagdShowSegment( pnt_ids_[i] );
-      }
-      else
-      {
-        pnt_id = cagdAddPoint( &cur_pnt );
-        pnt_ids_.push_back( pnt_id );
-        map_pnt_to_crv( pnt_id, this );
-      }
+  if( !get_ctrl_poly_pnts( poly_pnts ) )
+    return;
 
-      set_bi_color();
-      int poly_seg_id = cagdAddPolyline( pnts, 2 );
-      map_ctrl_seg_to_pnts( poly_seg_id, pnt_ids_[ i - 1 ], pnt_id );
-      poly_seg_ids_.push_back( poly_seg_id );
+  size_t cur_pnts_num = poly_pnts.size();
 
-      prev_pnt = cur_pnt;
-    }
+  if( cur_pnts_num == 0 )
+    clean_ctrl_pnts();
+  else if( pnt_seg_id_ != K_NOT_USED &&
+           cagdReusePointSet( pnt_seg_id_, poly_pnts.data(), cur_pnts_num ) )
+  {
+    cagdShowSegment( pnt_seg_id_ );
+  }
+  else
+  {
+    clean_ctrl_pnts();
+    set_norm_color();
+    pnt_seg_id_ = cagdAddPointSet( poly_pnts.data(), cur_pnts_num );
+    map_pnt_to_crv( pnt_seg_id_, this );
   }
 
-  pnt_ids_.resize( cur_pnts_num );
-}
-
-/******************************************************************************
-* Curve::get_pnt_id_idx
-******************************************************************************/
-int Curve::get_pnt_id_idx( int pnt_id )
-{
-  auto it = std::find( pnt_ids_.begin(), pnt_ids_.end(), pnt_id );
+  if( cur_pnts_num < 2 )
+  {
+    clean_ctrl_poly();
+    return;
+  }
 
-  if( it != pnt_ids_.end() )
-    return std::distance( pnt_ids_.begin(), it );
+  if( poly_seg_id_ != K_NOT_USED &&
+      cagdReusePolyline( poly_seg_id_, poly_pnts.data(), cur_pnts_num ) )
+  {
+    cagdShowSegment( poly_seg_id_ );
+  }
   else
-    return K_NOT_USED;
+  {
+    clean_ctrl_poly();
+    set_bi_color();
+    poly_seg_id_ = cagdAddPolyline( poly_pnts.data(), cur_pnts_num );
+    map_ctrl_seg_to_crv( poly_seg_id_, this );
+  }
 }
 
 /******************************************************************************
@@ -280,6 +316,27 @@ void Curve::update_weight( int pnt_idx, double val )
   ctrl_pnts_[ pnt_idx ].z = val;
 }
 
+/******************************************************************************
+* Curve::move_ctrl_pnt
+******************************************************************************/
+void Curve::move_ctrl_pnt( int pnt_idx, double new_x, double new_y )
+{
+  if( pnt_idx < 0 || ( size_t )pnt_idx >= ctrl_pnts_.size() )
+    throw std::runtime_error( "wrong ctrl pnt idx" );
+
+  ctrl_pnts_[ pnt_idx ].x = new_x;
+  ctrl_pnts_[ pnt_idx ].y = new_y;
+
+  // the displayed vertex has the same index, no need to rebuild the poly
+  CAGD_POINT pnt = { new_x, new_y, 0.0 };
+
+  if( pnt_seg_id_ != K_NOT_USED )
+    cagdSetVertex( pnt_seg_id_, pnt_idx, &pnt );
+
+  if( poly_seg_id_ != K_NOT_USED )
+    cagdSetVertex( poly_seg_id_, pnt_idx, &pnt );
+}
+
 /******************************************************************************
 * Curve::change_color
 ******************************************************************************/
@@ -0,0 +1,485 @@
+#include <memory>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+
+#include "history.h"
+#include "crv_utils.h"
+#include "crv_visit.h"
+#include "journal.h"
+#include "scene.h"
+
+#define K_HIST_MAX 1000
+
+typedef std::shared_ptr< const point_vec > pnts_ptr;
+typedef std::shared_ptr< const double_vec > knots_ptr;
+
+typedef struct
+{
+  CurveType kind;
+  int order;
+  pnts_ptr pnts; // nullptr if the curve does not exist in this state
+  knots_ptr knots;
+  bool is_uni;
+  bool is_open;
+  GLubyte color[ 3 ];
+} CurveState;
+
+typedef struct
+{
+  unsigned int uid;
+  CurveState before;
+  CurveState after;
+} CurveChange;
+
+typedef struct
+{
+  unsigned int uid;
+  int pnt_idx;
+  CAGD_POINT from;
+  CAGD_POINT to;
+} PntDrag;
+
+typedef struct
+{
+  unsigned int uid;
+  EditOp op;
+  int idx;
+  double val;
+} CrvEdit;
+
+typedef struct
+{
+  std::vector< CurveChange > changes;
+  std::vector< PntDrag > drags;
+  std::vector< CrvEdit > edits; // the changes that are single edits
+} HistEntry;
+
+struct HistState
+{
+  std::unordered_map< unsigned int, Curve * > live_crvs;
+  std::unordered_map< unsigned int, CurveState > last_states;
+  std::deque< HistEntry > undo_stack;
+  std::vector< HistEntry > redo_stack;
+  HistEntry pending;
+};
+
+static const CurveState K_NO_STATE = { CurveType::NONE, 0, nullptr, nullptr, false, false, { 0, 0, 0 } };
+
+/******************************************************************************
+* cur_hist
+******************************************************************************/
+static HistState &cur_hist()
+{
+  return *get_scene()->hist;
+}
+
+/******************************************************************************
+* same_pnts
+******************************************************************************/
+static bool same_pnts( const point_vec &pnts_1, const point_vec &pnts_2 )
+{
+  if( pnts_1.size() != pnts_2.size() )
+    return false;
+
+  for( size_t i = 0; i < pnts_1.size(); ++i )
+  {
+    if( pnts_1[ i ].x != pnts_2[ i ].x ||
+        pnts_1[ i ].y != pnts_2[ i ].y ||
+        pnts_1[ i ].z != pnts_2[ i ].z )
+      return false;
+  }
+
+  return true;
+}
+
+/******************************************************************************
+* same_state
+******************************************************************************/
+static bool same_state( const CurveState &state_1, const CurveState &state_2 )
+{
+  return state_1.pnts == state_2.pnts &&
+         state_1.knots == state_2.knots &&
+         state_1.order == state_2.order &&
+         state_1.is_uni == state_2.is_uni &&
+         state_1.is_open == state_2.is_open;
+}
+
+/******************************************************************************
+* take_state
+******************************************************************************/
+static CurveState take_state( const Curve *p_crv )
+{
+  HistState &hist = cur_hist();
+
+  auto it = hist.live_crvs.find( p_crv->uid_ );
+
+  if( it == hist.live_crvs.end() )
+    return K_NO_STATE;
+
+  // start from the previous snapshot so unchanged arrays are shared
+  CurveState &last = hist.last_states[ p_crv->uid_ ];
+  CurveState state = last;
+
+  state.kind = p_crv->kind_;
+  state.order = p_crv->order_;
+  state.color[ 0 ] = p_crv->color_[ 0 ];
+  state.color[ 1 ] = p_crv->color_[ 1 ];
+  state.color[ 2 ] = p_crv->color_[ 2 ];
+
+  if( state.pnts == nullptr || !same_pnts( *state.pnts, p_crv->ctrl_pnts_ ) )
+    state.pnts = std::make_shared< const point_vec >( p_crv->ctrl_pnts_ );
+
+  if( p_crv->kind_ == CurveType::BSPLINE )
+  {
+    const BSpline *p_bspline = static_cast< const BSpline * >( p_crv );
+
+    if( state.knots == nullptr || *state.knots != p_bspline->knots_ )
+      state.knots = std::make_shared< const double_vec >( p_bspline->knots_ );
+
+    state.is_uni = p_bspline->is_uni_;
+    state.is_open = p_bspline->is_open_;
+  }
+
+  last = state;
+  return state;
+}
+
+/******************************************************************************
+* redisplay_crv
+******************************************************************************/
+static void redisplay_crv( Curve *p_crv )
+{
+  p_crv->show_ctrl_poly();
+
+  if( p_crv->ctrl_pnts_.size() > 1 )
+    p_crv->show_crv();
+  else
+  {
+    for( auto seg_id : p_crv->seg_ids_ )
+      cagdHideSegment( seg_id );
+  }
+}
+
+/******************************************************************************
+* apply_state
+******************************************************************************/
+static void apply_state( unsigned int uid, const CurveState &state )
+{
+  HistState &hist = cur_hist();
+
+  auto it = hist.live_crvs.find( uid );
+  Curve *p_crv = it == hist.live_crvs.end() ? nullptr : it->second;
+
+  if( state.pnts == nullptr )
+  {
+    if( p_crv != nullptr )
+      free_crv( p_crv );
+
+    hist.last_states.erase( uid );
+    return;
+  }
+
+  bool is_new = p_crv == nullptr;
+
+  if( is_new )
+  {
+    if( state.kind == CurveType::BSPLINE )
+      p_crv = new BSpline();
+    else
+      p_crv = new Bezier();
+
+    p_crv->uid_ = uid;
+    p_crv->color_[ 0 ] = state.color[ 0 ];
+    p_crv->color_[ 1 ] = state.color[ 1 ];
+    p_crv->color_[ 2 ] = state.color[ 2 ];
+  }
+
+  p_crv->order_ = state.order;
+  p_crv->ctrl_pnts_ = *state.pnts;
+
+  if( p_crv->kind_ == CurveType::BSPLINE )
+  {
+    BSpline *p_bspline = static_cast< BSpline * >( p_crv );
+
+    p_bspline->knots_ = state.knots != nullptr ? *state.knots : double_vec();
+    p_bspline->is_uni_ = state.is_uni;
+    p_bspline->is_open_ = state.is_open;
+
+    if( !p_bspline->knots_.empty() )
+      p_bspline->update_u_vec();
+  }
+
+  hist.last_states[ uid ] = state;
+
+  if( is_new )
+    register_crv( p_crv );
+  else
+    redisplay_crv( p_crv );
+}
+
+/******************************************************************************
+* apply_drag
+******************************************************************************/
+static void apply_drag( const PntDrag &drag, bool is_undo )
+{
+  HistState &hist = cur_hist();
+
+  auto it = hist.live_crvs.find( drag.uid );
+
+  if( it == hist.live_crvs.end() )
+    return;
+
+  const CAGD_POINT &pos = is_undo ? drag.from : drag.to;
+  it->second->move_ctrl_pnt( drag.pnt_idx, pos.x, pos.y );
+
+  if( it->second->ctrl_pnts_.size() > 1 )
+    it->second->show_crv();
+}
+
+/******************************************************************************
+* journal_edits
+******************************************************************************/
+// journals the edits of a curve instead of its state, returns false if the
+// change is not made of edits
+static bool journal_edits( const HistEntry &entry, unsigned int uid )
+{
+  bool has_edits = false;
+
+  for( auto &edit : entry.edits )
+  {
+    if( edit.uid != uid )
+      continue;
+
+    journal_put_edit( uid, edit.op, edit.idx, edit.val );
+    has_edits = true;
+  }
+
+  return has_edits;
+}
+
+/******************************************************************************
+* journal_entry
+******************************************************************************/
+// journals the curves as an entry left them, in the order it was applied
+static void journal_entry( const HistEntry &entry, bool is_undo )
+{
+  HistState &hist = cur_hist();
+
+  if( is_undo )
+  {
+    for( auto &drag : entry.drags )
+      journal_put_drag( drag.uid, drag.pnt_idx, drag.from );
+  }
+
+  for( auto &change : entry.changes )
+  {
+    auto it = hist.live_crvs.find( change.uid );
+
+    // an undone edit has no edit to replay, the state is journaled instead
+    if( it == hist.live_crvs.end() )
+      journal_put_removed( change.uid );
+    else if( is_undo || !journal_edits( entry, change.uid ) )
+      journal_put_crv( it->second );
+  }
+
+  if( !is_undo )
+  {
+    for( auto &drag : entry.drags )
+      journal_put_drag( drag.uid, drag.pnt_idx, drag.to );
+  }
+
+  journal_end_op();
+}
+
+/******************************************************************************
+* hist_create
+******************************************************************************/
+HistState *hist_create()
+{
+  return new HistState();
+}
+
+/******************************************************************************
+* hist_destroy
+******************************************************************************/
+void hist_destroy( HistState *p_hist )
+{
+  delete p_hist;
+}
+
+/******************************************************************************
+* hist_track
+******************************************************************************/
+void hist_track( Curve *p_crv )
+{
+  cur_hist().live_crvs[ p_crv->uid_ ] = p_crv;
+}
+
+/******************************************************************************
+* hist_untrack
+******************************************************************************/
+void hist_untrack( Curve *p_crv )
+{
+  cur_hist().live_crvs.erase( p_crv->uid_ );
+}
+
+/******************************************************************************
+* hist_record
+******************************************************************************/
+void hist_record( Curve *p_crv )
+{
+  HistState &hist = cur_hist();
+
+  if( p_crv == nullptr )
+    return;
+
+  for( auto &change : hist.pending.changes )
+  {
+    if( change.uid == p_crv->uid_ )
+      return;
+  }
+
+  hist.pending.changes.push_back( { p_crv->uid_, take_state( p_crv ), K_NO_STATE } );
+}
+
+/******************************************************************************
+* hist_record_drag
+******************************************************************************/
+void hist_record_drag( Curve *p_crv,
+                       int pnt_idx,
+                       const CAGD_POINT &from,
+                       const CAGD_POINT &to )
+{
+  HistState &hist = cur_hist();
+
+  if( p_crv == nullptr || ( from.x == to.x && from.y == to.y ) )
+    return;
+
+  hist.pending.drags.push_back( { p_crv->uid_, pnt_idx, from, to } );
+}
+
+/******************************************************************************
+* hist_record_edit
+******************************************************************************/
+void hist_record_edit( Curve *p_crv, EditOp op, int idx, double val )
+{
+  if( p_crv == nullptr )
+    return;
+
+  cur_hist().pending.edits.push_back( { p_crv->uid_, op, idx, val } );
+}
+
+/******************************************************************************
+* hist_commit
+******************************************************************************/
+void hist_commit()
+{
+  HistState &hist = cur_hist();
+
+  HistEntry entry;
+  entry.drags.swap( hist.pending.drags );
+
+  for( auto &change : hist.pending.changes )
+  {
+    auto it = hist.live_crvs.find( change.uid );
+
+    if( it != hist.live_crvs.end() )
+      change.after = take_state( it->second );
+    else
+      hist.last_states.erase( change.uid );
+
+    if( !same_state( change.before, change.after ) )
+      entry.changes.push_back( change );
+  }
+
+  // edits that changed nothing have nothing to replay
+  for( auto &edit : hist.pending.edits )
+  {
+    for( auto &change : entry.changes )
+    {
+      if( change.uid == edit.uid )
+      {
+        entry.edits.push_back( edit );
+        break;
+      }
+    }
+  }
+
+  hist.pending.changes.clear();
+  hist.pending.edits.clear();
+
+  if( entry.changes.empty() && entry.drags.empty() )
+    return;
+
+  journal_entry( entry, false );
+  hist.undo_stack.push_back( std::move( entry ) );
+  hist.redo_stack.clear();
+
+  if( hist.undo_stack.size() > K_HIST_MAX )
+    hist.undo_stack.pop_front();
+}
+
+/******************************************************************************
+* hist_undo
+******************************************************************************/
+bool hist_undo()
+{
+  HistState &hist = cur_hist();
+
+  if( hist.undo_stack.empty() )
+    return false;
+
+  HistEntry entry = std::move( hist.undo_stack.back() );
+  hist.undo_stack.pop_back();
+
+  for( size_t i = entry.drags.size(); i > 0; --i )
+    apply_drag( entry.drags[ i - 1 ], true );
+
+  for( size_t i = entry.changes.size(); i > 0; --i )
+    apply_state( entry.changes[ i - 1 ].uid, entry.changes[ i - 1 ].before );
+
+  journal_entry( entry, true );
+  hist.redo_stack.push_back( std::move( entry ) );
+  return true;
+}
+
+/******************************************************************************
+* hist_redo
+******************************************************************************/
+bool hist_redo()
+{
+  HistState &hist = cur_hist();
+
+  if( hist.redo_stack.empty() )
+    return false;
+
+  HistEntry entry = std::move( hist.redo_stack.back() );
+  hist.redo_stack.pop_back();
+
+  for( auto &change : entry.changes )
+    apply_state( change.uid, change.after );
+
+  for( auto &drag : entry.drags )
+    apply_drag( drag, false );
+
+  journal_entry( entry, false );
+  hist.undo_stack.push_back( std::move( entry ) );
+  return true;
+}
+
+/******************************************************************************
+* hist_clear
+******************************************************************************/
+void hist_clear()
+{
+  HistState &hist = cur_hist();
+
+  hist.undo_stack.clear();
+  hist.redo_stack.clear();
+  hist.pending.changes.clear();
+  hist.pending.drags.clear();
+  hist.pending.edits.clear();
+  hist.last_states.clear();
+  hist.live_crvs.clear();
+}
@@ -11,7 +11,9 @@
 extern "C" {
 
   void drawSegments( GLenum );
+  BOOL isSegTableShown();
   void saveModelView();
+  void viewChanged();
   void rotateXY( int, int );
   void translateXY( int, int );
   void rotateZ( int, int );
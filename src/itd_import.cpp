@@ -0,0 +1,439 @@
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "itd_import.h"
+#include "crv_utils.h"
+#include "crv_load.h"
+#include "mapped_file.h"
+
+#define K_ITD_MAX_DEPTH 256 // of nested objects, deeper ones are skipped
+
+// a vertex is shared only if both its position and its normal match
+struct VertexKey
+{
+  double vals[ 6 ];
+
+  bool operator==( const VertexKey &other ) const
+  {
+    return memcmp( vals, other.vals, sizeof( vals ) ) == 0;
+  }
+};
+
+struct VertexKeyHash
+{
+  size_t operator()( const VertexKey &key ) const
+  {
+    return std::hash< std::string_view >()(
+      std::string_view( ( const char * )key.vals, sizeof( key.vals ) ) );
+  }
+};
+
+// faces of one IRIT object on their way to a mesh segment
+class MeshBuilder
+{
+public:
+  MeshBuilder() : has_normals_( false ) {}
+
+  void add_vertex( const CAGD_POINT &pnt, const CAGD_POINT *p_normal );
+  void end_face( UINT num_vertices );
+  UINT commit();
+
+private:
+  std::vector< CAGD_POINT > pnts_;
+  std::vector< CAGD_POINT > normals_;
+  std::vector< UINT > indices_;
+  std::vector< UINT > face_sizes_;
+  std::unordered_map< VertexKey, UINT, VertexKeyHash > ids_;
+  bool has_normals_;
+};
+
+// Recursive descent over the bracketed IRIT text,
+//
+//   [OBJECT name [attr ...] [POLYGON [PLANE a b c d] n
+//     [[NORMAL x y z] x y z] ... ] ... ]
+class ItdParser
+{
+public:
+  ItdParser( const char *begin, const char *end ) :
+    p_( begin ),
+    end_( end ),
+    num_meshes_( 0 ),
+    num_errors_( 0 )
+  {}
+
+  void parse();
+
+  size_t num_meshes() const { return num_meshes_; }
+  const std::string &first_error() const { return first_error_; }
+  size_t num_errors() const { return num_errors_; }
+
+private:
+  void skip_space();
+  bool accept( char c );
+  bool peek( char c );
+  std::string_view word();
+  bool number( double &val );
+  void skip_block();
+  void error( const char *message );
+
+  void parse_object( int depth );
+  void parse_polygon( MeshBuilder &mesh );
+  bool parse_vertex( MeshBuilder &mesh, const CAGD_POINT *p_plane_normal );
+
+  const char *p_;
+  const char *end_;
+  size_t num_meshes_;
+  std::string first_error_;
+  size_t num_errors_;
+};
+
+/******************************************************************************
+* normalized
+******************************************************************************/
+// -0 and 0 must hash alike
+static double normalized( double val )
+{
+  return val + 0.0;
+}
+
+/******************************************************************************
+* MeshBuilder::add_vertex
+******************************************************************************/
+void MeshBuilder::add_vertex( const CAGD_POINT &pnt, const CAGD_POINT *p_normal )
+{
+  CAGD_POINT normal = { 0.0, 0.0, 0.0 };
+
+  if( p_normal != nullptr )
+  {
+    normal = *p_normal;
+    has_normals_ = true;
+  }
+
+  VertexKey key = { { normalized( pnt.x ), normalized( pnt.y ), normalized( pnt.z ),
+                      normalized( normal.x ), normalized( normal.y ), normalized( normal.z ) } };
+  auto res = ids_.emplace( key, ( UINT )pnts_.size() );
+
+  if( res.second )
+  {
+    pnts_.push_back( pnt );
+    normals_.push_back( normal );
+  }
+
+  indices_.push_back( res.first->second );
+}
+
+/******************************************************************************
+* MeshBuilder::end_face
+******************************************************************************/
+void MeshBuilder::end_face( UINT num_vertices )
+{
+  if( num_vertices > 0 )
+    face_sizes_.push_back( num_vertices );
+}
+
+/******************************************************************************
+* MeshBuilder::commit
+******************************************************************************/
+UINT MeshBuilder::commit()
+{
+  UINT id = 0;
+
+  if( !face_sizes_.empty() )
+  {
+    id = cagdAddMesh( pnts_.data(),
+                      has_normals_ ? normals_.data() : NULL,
+                      ( UINT )pnts_.size(),
+                      indices_.data(),
+                      face_sizes_.data(),
+                      ( UINT )face_sizes_.size() );
+  }
+
+  *this = MeshBuilder();
+
+  return id;
+}
+
+/******************************************************************************
+* ItdParser::error
+******************************************************************************/
+void ItdParser::error( const char *message )
+{
+  if( num_errors_ == 0 )
+    first_error_ = message;
+
+  ++num_errors_;
+}
+
+/******************************************************************************
+* ItdParser::skip_space
+******************************************************************************/
+void ItdParser::skip_space()
+{
+  while( p_ < end_ )
+  {
+    if( *p_ == '#' )
+    {
+      while( p_ < end_ && *p_ != '\n' )
+        ++p_;
+    }
+    else if( isspace( ( unsigned char )*p_ ) )
+      ++p_;
+    else
+      break;
+  }
+}
+
+/******************************************************************************
+* ItdParser::peek
+******************************************************************************/
+bool ItdParser::peek( char c )
+{
+  skip_space();
+
+  return p_ < end_ && *p_ == c;
+}
+
+/******************************************************************************
+* ItdParser::accept
+******************************************************************************/
+bool ItdParser::accept( char c )
+{
+  if( !peek( c ) )
+    return false;
+
+  ++p_;
+  return true;
+}
+
+/******************************************************************************
+* ItdParser::word
+******************************************************************************/
+std::string_view ItdParser::word()
+{
+  skip_space();
+
+  const char *begin = p_;
+
+  while( p_ < end_ && *p_ != '[' && *p_ != ']' && !isspace( ( unsigned char )*p_ ) )
+    ++p_;
+
+  return std::string_view( begin, p_ - begin );
+}
+
+/******************************************************************************
+* ItdParser::number
+******************************************************************************/
+bool ItdParser::number( double &val )
+{
+  skip_space();
+
+  // from_chars does not take a leading plus
+  const char *begin = p_ < end_ && *p_ == '+' ? p_ + 1 : p_;
+  auto res = std::from_chars( begin, end_, val );
+
+  if( res.ec != std::errc() )
+    return false;
+
+  p_ = res.ptr;
+  return true;
+}
+
+/******************************************************************************
+* ItdParser::skip_block
+******************************************************************************/
+// skips the rest of the block whose '[' was already read
+void ItdParser::skip_block()
+{
+  int depth = 1;
+
+  while( p_ < end_ && depth > 0 )
+  {
+    if( *p_ == '[' )
+      ++depth;
+    else if( *p_ == ']' )
+      --depth;
+
+    ++p_;
+  }
+}
+
+/******************************************************************************
+* ItdParser::parse
+******************************************************************************/
+void ItdParser::parse()
+{
+  while( skip_space(), p_ < end_ )
+  {
+    if( *p_++ != '[' )
+    {
+      error( "Error in IRIT file, expected '['" );
+      word();
+      continue;
+    }
+
+    if( word() == "OBJECT" )
+      parse_object( 1 );
+    else
+      skip_block();
+  }
+}
+
+/******************************************************************************
+* ItdParser::parse_object
+******************************************************************************/
+void ItdParser::parse_object( int depth )
+{
+  MeshBuilder mesh;
+
+  if( !peek( '[' ) && !peek( ']' ) )
+    word(); // name
+
+  while( skip_space(), p_ < end_ && *p_ != ']' )
+  {
+    if( *p_++ != '[' )
+    {
+      error( "Error in IRIT object" );
+      word();
+      continue;
+    }
+
+    std::string_view keyword = word();
+
+    if( keyword == "POLYGON" )
+      parse_polygon( mesh );
+    else if( keyword == "OBJECT" && depth < K_ITD_MAX_DEPTH )
+      parse_object( depth + 1 );
+    else if( keyword == "OBJECT" )
+    {
+      error( "Error in IRIT object, nested too deep" );
+      skip_block();
+    }
+    else
+      skip_block();
+  }
+
+  accept( ']' );
+
+  if( mesh.commit() != 0 )
+    ++num_meshes_;
+}
+
+/******************************************************************************
+* ItdParser::parse_polygon
+******************************************************************************/
+void ItdParser::parse_polygon( MeshBuilder &mesh )
+{
+  CAGD_POINT plane_normal = { 0.0, 0.0, 0.0 };
+  bool has_plane = false;
+  double count = 0.0;
+
+  // attributes come before the vertex count
+  while( accept( '[' ) )
+  {
+    if( word() == "PLANE" )
+    {
+      double d;
+      has_plane = number( plane_normal.x ) && number( plane_normal.y ) &&
+                  number( plane_normal.z ) && number( d );
+    }
+
+    skip_block();
+  }
+
+  if( !number( count ) || !( count >= 0.0 && count <= INT_MAX ) )
+  {
+    error( "Error in IRIT polygon vertex count" );
+    skip_block();
+    return;
+  }
+
+  UINT num_vertices = 0;
+
+  for( int i = 0; i < ( int )count; ++i )
+  {
+    if( !accept( '[' ) )
+      break;
+
+    if( parse_vertex( mesh, has_plane ? &plane_normal : nullptr ) )
+      ++num_vertices;
+  }
+
+  if( num_vertices != ( UINT )count )
+    error( "Error in IRIT polygon vertices" );
+
+  mesh.end_face( num_vertices );
+  skip_block();
+}
+
+/******************************************************************************
+* ItdParser::parse_vertex
+******************************************************************************/
+// a vertex without a normal of its own gets the normal of its polygon
+bool ItdParser::parse_vertex( MeshBuilder &mesh, const CAGD_POINT *p_plane_normal )
+{
+  CAGD_POINT normal;
+  const CAGD_POINT *p_normal = p_plane_normal;
+  CAGD_POINT pnt;
+
+  while( accept( '[' ) )
+  {
+    if( word() == "NORMAL" && number( normal.x ) && number( normal.y ) && number( normal.z ) )
+      p_normal = &normal;
+
+    skip_block();
+  }
+
+  bool is_ok = number( pnt.x ) && number( pnt.y ) && number( pnt.z );
+
+  if( is_ok )
+    mesh.add_vertex( pnt, p_normal );
+
+  skip_block();
+  return is_ok;
+}
+
+/******************************************************************************
+* is_itd_file_path
+******************************************************************************/
+bool is_itd_file_path( const std::string &file_path )
+{
+  size_t ext_len = strlen( K_ITD_EXT );
+
+  if( file_path.size() < ext_len )
+    return false;
+
+  return _stricmp( file_path.c_str() + file_path.size() - ext_len, K_ITD_EXT ) == 0;
+}
+
+/******************************************************************************
+* import_itd_file
+******************************************************************************/
+size_t import_itd_file( const std::string &file_path )
+{
+  auto start = std::chrono::steady_clock::now();
+  MappedFile file( file_path );
+
+  if( !file.is_open() )
+  {
+    print_error( "Error opening file" );
+    return 0;
+  }
+
+  ItdParser parser( file.begin(), file.end() );
+
+  parser.parse();
+
+  report_parse_errors( parser.first_error(), parser.num_errors() );
+
+  std::chrono::duration< double > secs = std::chrono::steady_clock::now() - start;
+
+  printf( "Loaded %zu meshes in %.3f s\n", parser.num_meshes(), secs.count() );
+
+  return parser.num_meshes();
+}
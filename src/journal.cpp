@@ -0,0 +1,729 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "journal.h"
+#include "BSpline.h"
+#include "crv_binary.h"
+#include "crv_load.h"
+#include "crv_utils.h"
+#include "mapped_file.h"
+#include "scene.h"
+
+#define K_JOURNAL_EXT ".jrnl"
+#define K_JOURNAL_MAGIC 0x4c4e524a // "JRNL"
+#define K_JOURNAL_BATCH_OPS 64 // ops per sync
+#define K_JOURNAL_SYNC_MS 1000 // or when the oldest unsynced op is this old
+#define K_JOURNAL_TIMER_ID 0x4a52 // cagd's own timer is 0
+#define K_JOURNAL_MIN_COMPACT ( 4 << 20 ) // smaller journals are never compacted
+#define K_REC_HEADER_SIZE 8 // size and checksum of what follows
+
+enum
+{ /* record types */
+  K_REC_BASE = 1, // magic, generation, number of curves, their uids
+  K_REC_CRV,      // the whole state of a curve
+  K_REC_REMOVED,  // uid
+  K_REC_DRAG,     // uid, control point index, x, y
+  K_REC_CLEAR,
+  K_REC_EDIT      // uid, edit op, index, value
+};
+
+struct Journal
+{
+  Journal() : file( INVALID_HANDLE_VALUE ), p_scene( nullptr ), gen( 0 ), size( 0 ), snap_size( 0 ), num_ops( 0 ), has_timer( false ) {}
+
+  std::string base_path;
+  HANDLE file;
+  Scene *p_scene; // the journaled scene
+  uint32_t gen;
+  uint64_t size;
+  uint64_t snap_size;
+  std::vector< uint8_t > batch; // records not written yet
+  size_t num_ops;
+  bool has_timer; // set when the first unsynced op is batched
+};
+
+static Journal journal;
+
+// bounds checked reading of one record
+class RecordReader
+{
+public:
+  RecordReader( const uint8_t *begin, const uint8_t *end ) : p_( begin ), end_( end ) {}
+
+  template< typename T >
+  bool get( T &val )
+  {
+    if( ( size_t )( end_ - p_ ) < sizeof( T ) )
+      return false;
+
+    memcpy( &val, p_, sizeof( T ) );
+    p_ += sizeof( T );
+    return true;
+  }
+
+  template< typename T >
+  bool get_array( std::vector< T > &vals, uint32_t count )
+  {
+    if( ( size_t )( end_ - p_ ) / sizeof( T ) < count )
+      return false;
+
+    vals.resize( count );
+    memcpy( vals.data(), p_, count * sizeof( T ) );
+    p_ += count * sizeof( T );
+    return true;
+  }
+
+private:
+  const uint8_t *p_;
+  const uint8_t *end_;
+};
+
+/******************************************************************************
+* checksum
+******************************************************************************/
+// FNV-1a
+static uint32_t checksum( const uint8_t *p, size_t size )
+{
+  uint32_t hash = 2166136261u;
+
+  for( size_t i = 0; i < size; ++i )
+    hash = ( hash ^ p[ i ] ) * 16777619u;
+
+  return hash;
+}
+
+/******************************************************************************
+* put
+******************************************************************************/
+template< typename T >
+static void put( std::vector< uint8_t > &buf, const T &val )
+{
+  const uint8_t *p = ( const uint8_t * )&val;
+  buf.insert( buf.end(), p, p + sizeof( T ) );
+}
+
+/******************************************************************************
+* begin_record
+******************************************************************************/
+static size_t begin_record( std::vector< uint8_t > &buf, uint8_t type )
+{
+  size_t start = buf.size();
+
+  buf.resize( start + K_REC_HEADER_SIZE );
+  buf.push_back( type );
+
+  return start;
+}
+
+/******************************************************************************
+* end_record
+******************************************************************************/
+static void end_record( std::vector< uint8_t > &buf, size_t start )
+{
+  const uint8_t *p_body = buf.data() + start + K_REC_HEADER_SIZE;
+  uint32_t size = ( uint32_t )( buf.size() - start - K_REC_HEADER_SIZE );
+  uint32_t check = checksum( p_body, size );
+
+  memcpy( buf.data() + start, &size, sizeof( size ) );
+  memcpy( buf.data() + start + sizeof( size ), &check, sizeof( check ) );
+}
+
+/******************************************************************************
+* journal_path
+******************************************************************************/
+static std::string journal_path()
+{
+  return journal.base_path + K_JOURNAL_EXT;
+}
+
+/******************************************************************************
+* snap_path
+******************************************************************************/
+static std::string snap_path( uint32_t gen )
+{
+  return journal.base_path + "." + std::to_string( gen ) + K_CAGDB_EXT;
+}
+
+/******************************************************************************
+* is_active
+******************************************************************************/
+static bool is_active()
+{
+  return journal.file != INVALID_HANDLE_VALUE && get_scene() == journal.p_scene;
+}
+
+/******************************************************************************
+* write_all
+******************************************************************************/
+static bool write_all( HANDLE file, const std::vector< uint8_t > &buf )
+{
+  size_t done = 0;
+
+  while( done < buf.size() )
+  {
+    DWORD chunk = ( DWORD )min( buf.size() - done, ( size_t )( 1 << 30 ) );
+    DWORD written = 0;
+
+    if( !WriteFile( file, buf.data() + done, chunk, &written, NULL ) || written == 0 )
+      return false;
+
+    done += written;
+  }
+
+  return true;
+}
+
+/******************************************************************************
+* open_for_append
+******************************************************************************/
+static HANDLE open_for_append( const std::string &path )
+{
+  HANDLE file = CreateFileA( path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                             OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+  LARGE_INTEGER zero = {};
+
+  if( file != INVALID_HANDLE_VALUE )
+    SetFilePointerEx( file, zero, NULL, FILE_END );
+
+  return file;
+}
+
+/******************************************************************************
+* sync_file
+******************************************************************************/
+// flushes a file written through another handle, returns its size
+static bool sync_file( const std::string &path, uint64_t &size )
+{
+  HANDLE file = CreateFileA( path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+  LARGE_INTEGER file_size;
+
+  if( file == INVALID_HANDLE_VALUE )
+    return false;
+
+  bool is_ok = FlushFileBuffers( file ) && GetFileSizeEx( file, &file_size );
+
+  size = is_ok ? ( uint64_t )file_size.QuadPart : 0;
+  CloseHandle( file );
+
+  return is_ok;
+}
+
+/******************************************************************************
+* journal_sync
+******************************************************************************/
+static void journal_sync()
+{
+  if( journal.batch.empty() )
+    return;
+
+  if( !write_all( journal.file, journal.batch ) || !FlushFileBuffers( journal.file ) )
+    print_error( "Error writing the journal" );
+
+  journal.size += journal.batch.size();
+  journal.batch.clear();
+  journal.num_ops = 0;
+}
+
+/******************************************************************************
+* sync_timer
+******************************************************************************/
+// syncs the batch even if no op follows it
+static void CALLBACK sync_timer( HWND hwnd, UINT msg, UINT_PTR id, DWORD time )
+{
+  KillTimer( hwnd, id );
+  journal.has_timer = false;
+
+  if( journal.file != INVALID_HANDLE_VALUE )
+    journal_sync();
+}
+
+/******************************************************************************
+* apply_crv_record
+******************************************************************************/
+static bool apply_crv_record( RecordReader &reader,
+                              std::unordered_map< uint32_t, Curve * > &crvs )
+{
+  uint32_t uid;
+  uint8_t is_bspline;
+  uint8_t is_open;
+  uint8_t is_uni;
+  uint8_t color[ 3 ];
+  int32_t order;
+  uint32_t num_knots;
+  uint32_t num_pnts;
+  CurveRecord rec;
+
+  if( !reader.get( uid ) || !reader.get( is_bspline ) || !reader.get( is_open ) ||
+      !reader.get( is_uni ) || !reader.get( color ) || !reader.get( order ) ||
+      !reader.get( num_knots ) || !reader.get( num_pnts ) ||
+      !reader.get_array( rec.knots, num_knots ) || !reader.get_array( rec.pnts, num_pnts ) ||
+      order <= 0 )
+    return false;
+
+  rec.order = order;
+  rec.is_bspline = is_bspline != 0;
+  rec.is_open = is_open != 0;
+  rec.is_uni = is_uni != 0;
+
+  Curve *p_crv = build_curve( rec );
+
+  p_crv->color_[ 0 ] = color[ 0 ];
+  p_crv->color_[ 1 ] = color[ 1 ];
+  p_crv->color_[ 2 ] = color[ 2 ];
+
+  auto it = crvs.find( uid );
+
+  if( it != crvs.end() )
+    free_crv( it->second );
+
+  register_crv( p_crv );
+  crvs[ uid ] = p_crv;
+
+  return true;
+}
+
+/******************************************************************************
+* apply_edit_record
+******************************************************************************/
+static bool apply_edit_record( RecordReader &reader,
+                               std::unordered_map< uint32_t, Curve * > &crvs )
+{
+  uint32_t uid;
+  uint8_t op;
+  int32_t idx;
+  double val;
+
+  if( !reader.get( uid ) || !reader.get( op ) || !reader.get( idx ) || !reader.get( val ) )
+    return false;
+
+  auto it = crvs.find( uid );
+
+  if( it == crvs.end() )
+    return true;
+
+  Curve *p_crv = it->second;
+  bool is_bspline = p_crv->kind_ == CurveType::BSPLINE;
+
+  switch( ( EditOp )op )
+  {
+  case EditOp::INSERT_KNOT:
+    if( !is_bspline )
+      return false;
+
+    static_cast< BSpline * >( p_crv )->insertKnot( val );
+    break;
+  case EditOp::REMOVE_KNOT:
+    if( !is_bspline || idx < 0 || ( size_t )idx >= static_cast< BSpline * >( p_crv )->knots_.size() )
+      return false;
+
+    static_cast< BSpline * >( p_crv )->rmvKnot( idx );
+    break;
+  case EditOp::SET_WEIGHT:
+    if( idx < 0 || ( size_t )idx >= p_crv->ctrl_pnts_.size() )
+      return false;
+
+    p_crv->update_weight( idx, val );
+    break;
+  default:
+    return false;
+  }
+
+  p_crv->show_ctrl_poly();
+
+  if( p_crv->ctrl_pnts_.size() > 1 )
+    p_crv->show_crv();
+
+  return true;
+}
+
+/******************************************************************************
+* apply_record
+******************************************************************************/
+static bool apply_record( uint8_t type,
+                          RecordReader &reader,
+                          std::unordered_map< uint32_t, Curve * > &crvs )
+{
+  uint32_t uid;
+
+  switch( type )
+  {
+  case K_REC_CRV:
+    return apply_crv_record( reader, crvs );
+  case K_REC_REMOVED:
+  {
+    if( !reader.get( uid ) )
+      return false;
+
+    auto it = crvs.find( uid );
+
+    if( it != crvs.end() )
+    {
+      free_crv( it->second );
+      crvs.erase( it );
+    }
+
+    return true;
+  }
+  case K_REC_DRAG:
+  {
+    int32_t pnt_idx;
+    double x;
+    double y;
+
+    if( !reader.get( uid ) || !reader.get( pnt_idx ) || !reader.get( x ) || !reader.get( y ) )
+      return false;
+
+    auto it = crvs.find( uid );
+
+    if( it != crvs.end() && pnt_idx >= 0 && ( size_t )pnt_idx < it->second->ctrl_pnts_.size() )
+    {
+      it->second->move_ctrl_pnt( pnt_idx, x, y );
+
+      if( it->second->ctrl_pnts_.size() > 1 )
+        it->second->show_crv();
+    }
+
+    return true;
+  }
+  case K_REC_CLEAR:
+    clean_all_curves();
+    crvs.clear();
+    return true;
+  case K_REC_EDIT:
+    return apply_edit_record( reader, crvs );
+  }
+
+  return false;
+}
+
+/******************************************************************************
+* replay_journal
+******************************************************************************/
+// returns the generation of the replayed journal, 0 if there was none
+static uint32_t replay_journal()
+{
+  MappedFile file( journal_path() );
+
+  if( !file.is_mapped() )
+    return 0;
+
+  const uint8_t *p = ( const uint8_t * )file.begin();
+  const uint8_t *end = ( const uint8_t * )file.end();
+  std::unordered_map< uint32_t, Curve * > crvs;
+  uint32_t gen = 0;
+  size_t num_records = 0;
+
+  while( end - p >= K_REC_HEADER_SIZE + 1 )
+  {
+    uint32_t size;
+    uint32_t check;
+
+    memcpy( &size, p, sizeof( size ) );
+    memcpy( &check, p + sizeof( size ), sizeof( check ) );
+
+    const uint8_t *p_body = p + K_REC_HEADER_SIZE;
+
+    // a torn write at the end of the journal
+    if( size == 0 || size > ( size_t )( end - p_body ) || checksum( p_body, size ) != check )
+      break;
+
+    RecordReader reader( p_body + 1, p_body + size );
+    uint8_t type = p_body[ 0 ];
+
+    if( num_records == 0 )
+    {
+      uint32_t magic;
+      uint32_t num_crvs;
+      std::vector< uint32_t > uids;
+
+      if( type != K_REC_BASE || !reader.get( magic ) || magic != K_JOURNAL_MAGIC ||
+          !reader.get( gen ) || !reader.get( num_crvs ) || !reader.get_array( uids, num_crvs ) )
+      {
+        print_error( "Not a journal file" );
+        return 0;
+      }
+
+      size_t first_new_idx = load_binary_file( snap_path( gen ) );
+      const SlotMap< Curve * > &scene_crvs = get_scene()->curves;
+
+      if( scene_crvs.size() - first_new_idx != num_crvs )
+        print_error( "Journal snapshot is missing curves" );
+
+      for( size_t i = 0; i < num_crvs && first_new_idx + i < scene_crvs.size(); ++i )
+        crvs[ uids[ i ] ] = scene_crvs[ first_new_idx + i ];
+    }
+    else if( !apply_record( type, reader, crvs ) )
+    {
+      print_error( "Corrupt journal record" );
+      break;
+    }
+
+    p = p_body + size;
+    ++num_records;
+  }
+
+  printf( "Recovered %zu journal records\n", num_records > 0 ? num_records - 1 : 0 );
+
+  return gen;
+}
+
+/******************************************************************************
+* journal_open
+******************************************************************************/
+bool journal_open( const std::string &base_path )
+{
+  static bool is_exit_registered = false;
+
+  journal_close();
+  journal.base_path = base_path;
+  journal.gen = replay_journal();
+  journal.p_scene = get_scene();
+  journal.file = open_for_append( journal_path() );
+
+  if( journal.file == INVALID_HANDLE_VALUE )
+  {
+    print_error( "Error opening the journal" );
+    return false;
+  }
+
+  // start over from a snapshot of what was recovered
+  uint32_t old_gen = journal.gen;
+
+  journal_compact();
+
+  if( journal.gen == old_gen )
+  {
+    journal_close();
+    return false;
+  }
+
+  if( !is_exit_registered )
+  {
+    atexit( journal_close );
+    is_exit_registered = true;
+  }
+
+  cagdRedraw();
+  return true;
+}
+
+/******************************************************************************
+* journal_close
+******************************************************************************/
+void journal_close()
+{
+  if( journal.file == INVALID_HANDLE_VALUE )
+    return;
+
+  if( journal.has_timer )
+  {
+    KillTimer( cagdGetWindow(), K_JOURNAL_TIMER_ID );
+    journal.has_timer = false;
+  }
+
+  journal_sync();
+  CloseHandle( journal.file );
+  journal.file = INVALID_HANDLE_VALUE;
+  journal.p_scene = nullptr;
+}
+
+/******************************************************************************
+* journal_is_open
+******************************************************************************/
+bool journal_is_open()
+{
+  return journal.file != INVALID_HANDLE_VALUE;
+}
+
+/******************************************************************************
+* journal_compact
+******************************************************************************/
+void journal_compact()
+{
+  if( !is_active() )
+    return;
+
+  uint32_t gen = journal.gen + 1;
+  std::string new_snap_path = snap_path( gen );
+  std::string tmp_path = journal_path() + ".tmp";
+  uint64_t snap_size = 0;
+
+  // the snapshot has no uids, the journal lists them in the snapshot's order
+  std::vector< uint8_t > buf;
+  size_t start = begin_record( buf, K_REC_BASE );
+  const SlotMap< Curve * > &crvs = get_scene()->curves;
+
+  put( buf, ( uint32_t )K_JOURNAL_MAGIC );
+  put( buf, gen );
+  put( buf, ( uint32_t )crvs.size() );
+
+  for( auto p_crv : crvs )
+    put( buf, ( uint32_t )p_crv->uid_ );
+
+  end_record( buf, start );
+
+  if( !save_binary_file( new_snap_path ) || !sync_file( new_snap_path, snap_size ) )
+  {
+    DeleteFileA( new_snap_path.c_str() );
+    return;
+  }
+
+  HANDLE tmp_file = CreateFileA( tmp_path.c_str(), GENERIC_WRITE, 0, NULL,
+                                 CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+  bool is_ok = tmp_file != INVALID_HANDLE_VALUE &&
+               write_all( tmp_file, buf ) &&
+               FlushFileBuffers( tmp_file );
+
+  if( tmp_file != INVALID_HANDLE_VALUE )
+    CloseHandle( tmp_file );
+
+  // the new journal replaces the old one in a single step, until then the
+  // old journal and its snapshot are still whole
+  CloseHandle( journal.file );
+
+  if( is_ok )
+    is_ok = MoveFileExA( tmp_path.c_str(), journal_path().c_str(),
+                         MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != FALSE;
+
+  if( is_ok )
+  {
+    DeleteFileA( snap_path( journal.gen ).c_str() );
+    journal.gen = gen;
+    journal.size = buf.size();
+    journal.snap_size = snap_size;
+    journal.batch.clear();
+    journal.num_ops = 0;
+  }
+  else
+  {
+    print_error( "Error compacting the journal" );
+    DeleteFileA( tmp_path.c_str() );
+    DeleteFileA( new_snap_path.c_str() );
+  }
+
+  journal.file = open_for_append( journal_path() );
+}
+
+/******************************************************************************
+* journal_put_crv
+******************************************************************************/
+void journal_put_crv( const Curve *p_crv )
+{
+  if( !is_active() )
+    return;
+
+  std::vector< uint8_t > &buf = journal.batch;
+  const BSpline *p_bspline = nullptr;
+
+  if( p_crv->kind_ == CurveType::BSPLINE )
+    p_bspline = static_cast< const BSpline * >( p_crv );
+
+  size_t start = begin_record( buf, K_REC_CRV );
+
+  put( buf, ( uint32_t )p_crv->uid_ );
+  put( buf, ( uint8_t )( p_bspline != nullptr ) );
+  put( buf, ( uint8_t )( p_bspline != nullptr && p_bspline->is_open_ ) );
+  put( buf, ( uint8_t )( p_bspline != nullptr && p_bspline->is_uni_ ) );
+  put( buf, p_crv->color_[ 0 ] );
+  put( buf, p_crv->color_[ 1 ] );
+  put( buf, p_crv->color_[ 2 ] );
+  put( buf, ( int32_t )p_crv->order_ );
+  put( buf, ( uint32_t )( p_bspline != nullptr ? p_bspline->knots_.size() : 0 ) );
+  put( buf, ( uint32_t )p_crv->ctrl_pnts_.size() );
+
+  if( p_bspline != nullptr )
+  {
+    for( auto knot : p_bspline->knots_ )
+      put( buf, knot );
+  }
+
+  for( auto &pnt : p_crv->ctrl_pnts_ )
+    put( buf, pnt );
+
+  end_record( buf, start );
+}
+
+/******************************************************************************
+* journal_put_removed
+******************************************************************************/
+void journal_put_removed( unsigned int uid )
+{
+  if( !is_active() )
+    return;
+
+  size_t start = begin_record( journal.batch, K_REC_REMOVED );
+
+  put( journal.batch, ( uint32_t )uid );
+  end_record( journal.batch, start );
+}
+
+/******************************************************************************
+* journal_put_drag
+******************************************************************************/
+void journal_put_drag( unsigned int uid, int pnt_idx, const CAGD_POINT &pos )
+{
+  if( !is_active() )
+    return;
+
+  size_t start = begin_record( journal.batch, K_REC_DRAG );
+
+  put( journal.batch, ( uint32_t )uid );
+  put( journal.batch, ( int32_t )pnt_idx );
+  put( journal.batch, pos.x );
+  put( journal.batch, pos.y );
+  end_record( journal.batch, start );
+}
+
+/******************************************************************************
+* journal_put_edit
+******************************************************************************/
+void journal_put_edit( unsigned int uid, EditOp op, int idx, double val )
+{
+  if( !is_active() )
+    return;
+
+  size_t start = begin_record( journal.batch, K_REC_EDIT );
+
+  put( journal.batch, ( uint32_t )uid );
+  put( journal.batch, ( uint8_t )op );
+  put( journal.batch, ( int32_t )idx );
+  put( journal.batch, val );
+  end_record( journal.batch, start );
+}
+
+/******************************************************************************
+* journal_put_clear
+******************************************************************************/
+void journal_put_clear()
+{
+  if( !is_active() )
+    return;
+
+  size_t start = begin_record( journal.batch, K_REC_CLEAR );
+  end_record( journal.batch, start );
+}
+
+/******************************************************************************
+* journal_end_op
+******************************************************************************/
+void journal_end_op()
+{
+  if( !is_active() || journal.batch.empty() )
+    return;
+
+  if( ++journal.num_ops >= K_JOURNAL_BATCH_OPS )
+    journal_sync();
+  else if( !journal.has_timer )
+  {
+    // the first op of a batch, the timer syncs it if no more ops come
+    SetTimer( cagdGetWindow(), K_JOURNAL_TIMER_ID, K_JOURNAL_SYNC_MS, sync_timer );
+    journal.has_timer = true;
+  }
+
+  if( journal.size > K_JOURNAL_MIN_COMPACT && journal.size > 2 * journal.snap_size )
+    journal_compact();
+}
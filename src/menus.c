@@ -6,6 +6,11 @@
 #include "options.h"
 #include <vectors.h>
 #include "crv_utils.h"
+#include "history.h"
+#include "crv_load.h"
+#include "journal.h"
+#include "tess_cache.h"
+#include "paged_scene.h"
 
 char buffer1[ BUFSIZ ];
 char buffer2[ BUFSIZ ];
@@ -21,15 +26,19 @@ ConnType conn = ConnType::NONE;
 Curve *active_rmb_curve = nullptr;
 int active_polyline_id;
 int active_pnt_id = K_NOT_USED;
+int active_pnt_idx = K_NOT_USED;
 int active_rmb_ctrl_polyline = K_NOT_USED;
+int active_rmb_ctrl_edge = K_NOT_USED;
 int cur_rmb_screen_pick[ 2 ] = { K_NOT_USED, K_NOT_USED };
 int hilited_pt_id = K_NOT_USED;
+int hilited_pt_idx = K_NOT_USED;
 bool add_bezier_is_active = false;
 Bezier *add_bezier_active_crv = nullptr;
 bool add_bspline_is_active = false;
 BSpline *add_bspline_active_crv = nullptr;
 Curve *active_lmb_curve = nullptr;
 CAGD_POINT lmb_pnt = { 0 };
+CAGD_POINT drag_start_pnt = { 0 };
 
 extern void myMessage( PSTR title, PSTR message, UINT crv_type );
 
@@ -41,10 +50,13 @@ void reset_active()
   conn = ConnType::NONE;
   active_rmb_curve = nullptr;
   active_pnt_id = K_NOT_USED;
+  active_pnt_idx = K_NOT_USED;
   active_rmb_ctrl_polyline = K_NOT_USED;
+  active_rmb_ctrl_edge = K_NOT_USED;
   cur_rmb_screen_pick[ 0 ] = K_NOT_USED;
   cur_rmb_screen_pick[ 1 ] = K_NOT_USED;
   hilited_pt_id = K_NOT_USED;
+  hilited_pt_idx = K_NOT_USED;
   add_bezier_is_active = false;
   add_bezier_active_crv = nullptr;
   add_bspline_is_active = false;
@@ -60,19 +72,30 @@ void init_menus()
 {
   HMENU op_menu = CreatePopupMenu(); // options
   HMENU curve_menu = CreatePopupMenu(); // Curve
+  HMENU edit_menu = CreatePopupMenu(); // Edit
 
   g_op_menu = op_menu;
 
+  // Edit
+  AppendMenu( edit_menu, MF_STRING, CAGD_UNDO, "Undo\tCtrl+Z" );
+  AppendMenu( edit_menu, MF_STRING, CAGD_REDO, "Redo\tCtrl+Y" );
+  AppendMenu( edit_menu, MF_SEPARATOR, 0, NULL );
+  AppendMenu( edit_menu, MF_STRING, CAGD_CANCEL_LOAD, "Cancel Load\tEsc" );
+
   // Curve
   AppendMenu( curve_menu, MF_STRING, CAGD_CURVE_COLOR, "Default Color" );
 
   // Options
   AppendMenu( op_menu, MF_STRING, CAGD_SETTINGS, "Settings" );
   AppendMenu( op_menu, MF_STRING, CAGD_HIDE_CTRL_POLYS, "Hide Control Polylines" );
+  AppendMenu( op_menu, MF_STRING, CAGD_PACK_SAVES, "Pack Binary Files" );
+  AppendMenu( op_menu, MF_STRING, CAGD_AUTOSAVE, "Autosave" );
+  AppendMenu( op_menu, MF_STRING, CAGD_TESS_CACHE, "Tessellation Cache" );
   AppendMenu( op_menu, MF_SEPARATOR, 0, NULL );
   AppendMenu( op_menu, MF_STRING, CAGD_CLEAN_ALL, "Clean all" );
 
   // adding to cagd
+  cagdAppendMenu( edit_menu, "Edit" );
   cagdAppendMenu( curve_menu, "Curve" );
   cagdAppendMenu( op_menu, "Options" );
 
@@ -199,7 +222,7 @@ LRESULT CALLBACK SettingsDialogProc( HWND hDialog, UINT message, WPARAM wParam,
 LRESULT CALLBACK WeightDialogProc( HWND hDialog, UINT message, WPARAM wParam, LPARAM lParam )
 {
   Curve *p_curve = active_rmb_curve;
-  auto ctrl_idx = p_curve->get_pnt_id_idx( active_pnt_id );
+  auto ctrl_idx = active_pnt_idx;
 
   switch( message )
   {
@@ -346,6 +369,18 @@ void menu_callbacks( int id, int unUsed, PVOID userData )
   case CAGD_ADD_KNOT:
     handle_rmb_add_knot_menu();
     break;
+  case CAGD_REDUCE_KNOTS:
+    handle_rmb_reduce_knots();
+    break;
+  case CAGD_REDUCE_ALL_KNOTS:
+    reduce_all_knots( DEF_REDUCE_TOL );
+    break;
+  case CAGD_ELEVATE_DEGREE:
+    handle_rmb_elevate_degree();
+    break;
+  case CAGD_REDUCE_DEGREE:
+    handle_rmb_reduce_degree();
+    break;
   case CAGD_OPEN_KNOTS:
     handle_rmb_open_knots();
     break;
@@ -361,6 +396,24 @@ void menu_callbacks( int id, int unUsed, PVOID userData )
   case CAGD_HIDE_CTRL_POLYS:
     handle_hide_ctrl_polys_menu();
     break;
+  case CAGD_UNDO:
+    handle_undo_menu();
+    break;
+  case CAGD_REDO:
+    handle_redo_menu();
+    break;
+  case CAGD_CANCEL_LOAD:
+    cancel_async_load();
+    break;
+  case CAGD_PACK_SAVES:
+    handle_pack_saves_menu();
+    break;
+  case CAGD_AUTOSAVE:
+    handle_autosave_menu();
+    break;
+  case CAGD_TESS_CACHE:
+    handle_tess_cache_menu();
+    break;
   }
 }
 
@@ -371,7 +424,9 @@ void handle_rmb_remove_curve()
 {
   if( active_rmb_curve != nullptr )
   {
+    hist_record( active_rmb_curve );
     free_crv( active_rmb_curve );
+    hist_commit();
     cagdRedraw();
   }
 
@@ -384,45 +439,33 @@ void handle_rmb_remove_curve()
 void handle_rmb_insert_ctrl_pt()
 {
   Curve *p_curve = active_rmb_curve;
-
-  std::tuple< int, int > end_pnts =
-    get_ctrl_seg_pnts( active_rmb_ctrl_polyline );
-
-  auto ctrl_idx = p_curve->get_pnt_id_idx( std::get< 1 >( end_pnts ) );
+  int ctrl_idx = active_rmb_ctrl_edge;
 
   if( p_curve != nullptr &&
       ctrl_idx != K_NOT_USED &&
       active_rmb_ctrl_polyline != K_NOT_USED )
   {
-    Bezier *bz_crv = dynamic_cast< Bezier * >( p_curve );
-    BSpline *bs_crv = dynamic_cast< BSpline * >( p_curve );
-
     CAGD_POINT pick_pnt = screen_to_world_coord( cur_rmb_screen_pick[ 0 ],
                                                  cur_rmb_screen_pick[ 1 ] );
 
-    if( bz_crv != nullptr )
+    hist_record( p_curve );
+    p_curve->add_ctrl_pnt( pick_pnt, ctrl_idx );
+    hist_commit();
+
+    BSpline *bs_crv = p_curve->kind_ == CurveType::BSPLINE ?
+                      ( BSpline * )p_curve : nullptr;
+
+    if( bs_crv != nullptr &&
+        bs_crv->knots_.size() != bs_crv->ctrl_pnts_.size() + bs_crv->order_ )
     {
-      bz_crv->add_ctrl_pnt( pick_pnt, ctrl_idx );
-      bz_crv->show_ctrl_poly();
-      bz_crv->show_crv();
+      print_error( "Please make sure the number of knots is\n"
+                   "the number of control points plus the order." );
     }
-    else if( bs_crv != nullptr )
+    else
     {
-      bs_crv->add_ctrl_pnt( pick_pnt, ctrl_idx );
-
-      if( bs_crv->knots_.size() != bs_crv->ctrl_pnts_.size() + bs_crv->order_ )
-      {
-        print_error( "Please make sure the number of knots is\n"
-                     "the number of control points plus the order." );
-      }
-      else
-      {
-        bs_crv->show_ctrl_poly();
-        bs_crv->show_crv();
-      }
+      p_curve->show_ctrl_poly();
+      p_curve->show_crv();
     }
-    else
-      print_error( "Error removing control point" );
 
     cagdRedraw();
   }
@@ -439,9 +482,6 @@ void handle_rmb_prepend_ctrl_pt()
 
   if( p_curve != nullptr )
   {
-    Bezier *bz_crv = dynamic_cast< Bezier * >( p_curve );
-    BSpline *bs_crv = dynamic_cast< BSpline * >( p_curve );
-
     CAGD_POINT new_pt_loc;
     CAGD_POINT location_vec;
     CAGD_POINT p0 = p_curve->ctrl_pnts_[0];
@@ -450,18 +490,11 @@ void handle_rmb_prepend_ctrl_pt()
 
     add_vecs( &p0, &location_vec, &new_pt_loc );
 
-    if( bz_crv != nullptr )
-    {
-      bz_crv->add_ctrl_pnt( new_pt_loc, 0 );
-      bz_crv->show_ctrl_poly();
-      bz_crv->show_crv();
-    }
-    else if( bs_crv != nullptr )
-    {
-      bs_crv->add_ctrl_pnt( new_pt_loc, 0 ); // not working good
-      bs_crv->show_ctrl_poly();
-      bs_crv->show_crv();
-    }
+    hist_record( p_curve );
+    p_curve->add_ctrl_pnt( new_pt_loc, 0 ); // not working good for bspline
+    hist_commit();
+    p_curve->show_ctrl_poly();
+    p_curve->show_crv();
 
     cagdRedraw();
   }
@@ -478,9 +511,6 @@ void handle_rmb_append_ctrl_pt()
 
   if( p_curve != nullptr )
   {
-    Bezier *bz_crv = dynamic_cast< Bezier * >( p_curve );
-    BSpline *bs_crv = dynamic_cast< BSpline * >( p_curve );
-
     int num_ctrl_pts = p_curve->ctrl_pnts_.size();
 
     if( num_ctrl_pts > 1 )
@@ -493,18 +523,11 @@ void handle_rmb_append_ctrl_pt()
 
       add_vecs( &p0, &location_vec, &new_pt_loc );
 
-      if( bz_crv != nullptr )
-      {
-        bz_crv->add_ctrl_pnt( new_pt_loc, num_ctrl_pts );
-        bz_crv->show_ctrl_poly();
-        bz_crv->show_crv();
-      }
-      else if( bs_crv != nullptr )
-      {
-        bs_crv->add_ctrl_pnt( new_pt_loc, num_ctrl_pts ); // not working good
-        bs_crv->show_ctrl_poly();
-        bs_crv->show_crv();
-      }
+      hist_record( p_curve );
+      p_curve->add_ctrl_pnt( new_pt_loc, num_ctrl_pts ); // not working good for bspline
+      hist_commit();
+      p_curve->show_ctrl_poly();
+      p_curve->show_crv();
 
       cagdRedraw();
     }
@@ -548,29 +571,18 @@ void handle_rmb_connect_g1()
 void handle_rmb_remove_ctrl_pt()
 {
   Curve *p_curve = active_rmb_curve;
-  auto ctrl_idx = p_curve->get_pnt_id_idx( active_pnt_id );
+  auto ctrl_idx = active_pnt_idx;
 
   if( p_curve != nullptr && ctrl_idx != K_NOT_USED )
   {
-    Bezier *bz_crv = dynamic_cast< Bezier * >( p_curve );
-    BSpline *bs_crv = dynamic_cast< BSpline * >( p_curve );
-
-    if( bz_crv != nullptr )
-    {
-      bz_crv->rmv_ctrl_pnt( ctrl_idx );
-      bz_crv->show_ctrl_poly();
-      bz_crv->show_crv();
-    }
-    else if( bs_crv != nullptr )
-    {
-      bs_crv->rmv_ctrl_pnt( ctrl_idx );
-      bs_crv->show_ctrl_poly();
-      bs_crv->show_crv();
-    }
-    else
-      print_error( "Error removing control point" );
+    hist_record( p_curve );
+    p_curve->rmv_ctrl_pnt( ctrl_idx );
+    hist_commit();
+    p_curve->show_ctrl_poly();
+    p_curve->show_crv();
 
     hilited_pt_id = K_NOT_USED;
+    hilited_pt_idx = K_NOT_USED;
 
     cagdRedraw();
   }
@@ -628,7 +640,9 @@ void handle_hide_ctrl_polys_menu()
 void handle_rmb_rmv_uni_knots()
 {
   BSpline *p_bspline = ( BSpline * )active_rmb_curve;
+  hist_record( p_bspline );
   p_bspline->is_uni_ = false;
+  hist_commit();
 }
 
 /******************************************************************************
@@ -637,7 +651,9 @@ void handle_rmb_rmv_uni_knots()
 void handle_rmb_rmv_open_knots()
 {
   BSpline *p_bspline = ( BSpline * )active_rmb_curve;
+  hist_record( p_bspline );
   p_bspline->is_open_ = false;
+  hist_commit();
 }
 
 /******************************************************************************
@@ -646,7 +662,9 @@ void handle_rmb_rmv_open_knots()
 void handle_rmb_open_knots()
 {
   BSpline *p_bspline = ( BSpline * )active_rmb_curve;
+  hist_record( p_bspline );
   p_bspline->makeOpenKnotVector();
+  hist_commit();
   p_bspline->show_crv();
   p_bspline->show_ctrl_poly();
 }
@@ -657,7 +675,9 @@ void handle_rmb_open_knots()
 void handle_rmb_uni_knots()
 {
   BSpline *p_bspline = ( BSpline * )active_rmb_curve;
+  hist_record( p_bspline );
   p_bspline->makeUniformKnotVector();
+  hist_commit();
   p_bspline->show_crv();
   p_bspline->show_ctrl_poly();
 }
@@ -674,7 +694,9 @@ void handle_rmb_mod_knots()
                  cagdGetWindow(),
                  ( DLGPROC )KnotsDialogProc ) )
   {
+    hist_record( p_bspline );
     p_bspline->parseKnotsDescription( knots_buf );
+    hist_commit();
 
     if( p_bspline->knots_.size() != p_bspline->ctrl_pnts_.size() + p_bspline->order_ )
     {
@@ -705,7 +727,10 @@ void handle_rmb_add_knot_menu()
 
     if( sscanf( buffer1, "%lf", &knot_value ) == 1 )
     {
+      hist_record( p_bspline );
+      hist_record_edit( p_bspline, EditOp::INSERT_KNOT, K_NOT_USED, knot_value );
       p_bspline->insertKnot( knot_value );
+      hist_commit();
       p_bspline->show_crv();
       p_bspline->show_ctrl_poly();
       cagdRedraw();
@@ -715,6 +740,80 @@ void handle_rmb_add_knot_menu()
   }
 }
 
+/******************************************************************************
+* handle_rmb_reduce_knots
+******************************************************************************/
+void handle_rmb_reduce_knots()
+{
+  BSpline *p_bspline = ( BSpline * )active_rmb_curve;
+
+  hist_record( p_bspline );
+
+  int num_removed = p_bspline->removeKnots( DEF_REDUCE_TOL );
+
+  hist_commit();
+
+  std::string message = "Removed " + std::to_string( num_removed ) + " knots.";
+  cagdSetHelpText( message.c_str() );
+  cagdShowHelp();
+
+  if( num_removed > 0 )
+  {
+    p_bspline->show_crv();
+    p_bspline->show_ctrl_poly();
+    cagdRedraw();
+  }
+}
+
+/******************************************************************************
+* handle_rmb_elevate_degree
+******************************************************************************/
+void handle_rmb_elevate_degree()
+{
+  Curve *p_curve = active_rmb_curve;
+
+  hist_record( p_curve );
+
+  bool is_elevated = p_curve->elevateDegree( 1 );
+
+  hist_commit();
+
+  if( is_elevated )
+  {
+    p_curve->show_crv();
+    p_curve->show_ctrl_poly();
+    cagdRedraw();
+  }
+  else
+    print_error( "The degree cannot be elevated." );
+}
+
+/******************************************************************************
+* handle_rmb_reduce_degree
+******************************************************************************/
+void handle_rmb_reduce_degree()
+{
+  Curve *p_curve = active_rmb_curve;
+  int order = p_curve->order_ > DEF_ORDER ? DEF_ORDER : p_curve->order_ - 1;
+  BSpline *p_lower = lower_crv_order( p_curve, order, DEF_REDUCE_TOL );
+
+  if( p_lower == nullptr )
+  {
+    print_error( "The degree cannot be reduced." );
+    return;
+  }
+
+  clean_active_rmb_data();
+  cagdRedraw();
+
+  std::string message = "Order " + std::to_string( p_lower->order_ ) +
+                        " curve with " +
+                        std::to_string( p_lower->ctrl_pnts_.size() ) +
+                        " control points.";
+  cagdSetHelpText( message.c_str() );
+  cagdShowHelp();
+}
+
 /******************************************************************************
 * handle_change_weight_menu
 ******************************************************************************/
@@ -729,10 +828,9 @@ void handle_change_weight_menu()
 
     if( sscanf( buffer1, "%lf", &new_weight ) == 1 && new_weight > 0 )
     {
-      Curve *p_curve = active_rmb_curve;
-      auto ctrl_idx = p_curve->get_pnt_id_idx( active_pnt_id );
+      auto ctrl_idx = active_pnt_idx;
 
-      if( ctrl_idx > 0 )
+      if( ctrl_idx != K_NOT_USED )
         update_weight_callback( active_pnt_id, ctrl_idx, new_weight );
     }
     else
@@ -742,6 +840,71 @@ void handle_change_weight_menu()
   clean_active_rmb_data();
 }
 
+/******************************************************************************
+* handle_pack_saves_menu
+******************************************************************************/
+void handle_pack_saves_menu()
+{
+  toggle_check_menu( g_op_menu, CAGD_PACK_SAVES );
+  set_pack_saves( !get_pack_saves() );
+}
+
+/******************************************************************************
+* handle_autosave_menu
+******************************************************************************/
+void handle_autosave_menu()
+{
+  // turning autosave on recovers what the last session left unsaved
+  if( journal_is_open() )
+    journal_close();
+  else if( paged_scene_is_open() )
+  {
+    print_error( "Autosave is not available while a file is paged" );
+    return;
+  }
+  else if( !journal_open( K_AUTOSAVE_PATH ) )
+    return;
+
+  toggle_check_menu( g_op_menu, CAGD_AUTOSAVE );
+}
+
+/******************************************************************************
+* handle_tess_cache_menu
+******************************************************************************/
+void handle_tess_cache_menu()
+{
+  if( tess_cache_is_open() )
+    tess_cache_close();
+  else if( !tess_cache_open( K_TESS_CACHE_PATH ) )
+    return;
+
+  toggle_check_menu( g_op_menu, CAGD_TESS_CACHE );
+}
+
+/******************************************************************************
+* handle_undo_menu
+******************************************************************************/
+void handle_undo_menu()
+{
+  if( hist_undo() )
+  {
+    reset_active();
+    cagdRedraw();
+  }
+}
+
+/******************************************************************************
+* handle_redo_menu
+******************************************************************************/
+void handle_redo_menu()
+{
+  if( hist_redo() )
+  {
+    reset_active();
+    cagdRedraw();
+  }
+}
+
 /******************************************************************************
 * handle_settings_menu
 ******************************************************************************/
@@ -773,6 +936,7 @@ void handle_settings_menu()
 ******************************************************************************/
 void handle_clean_all_menu()
 {
+  cancel_async_load();
   clean_all_curves();
   reset_active();
 }
@@ -791,7 +955,9 @@ void handle_add_curve_menu()
     Bezier *p_bezier = new Bezier();
     p_bezier->order_ = 0;
     p_bezier->add_ctrl_pnt( pt0, 0 );
+    hist_record( p_bezier );
     register_crv( p_bezier );
+    hist_commit();
     add_bezier_active_crv = p_bezier;
     p_bezier->change_color( 204, 102, 0 );
   }
@@ -800,7 +966,9 @@ void handle_add_curve_menu()
     BSpline *p_bspline = new BSpline();
     p_bspline->order_ = get_def_degree();
     p_bspline->add_ctrl_pnt( pt0, 0 );
+    hist_record( p_bspline );
     register_crv( p_bspline );
+    hist_commit();
     add_bspline_active_crv = p_bspline;
     p_bspline->change_color( 204, 102, 0 );
   }
@@ -822,15 +990,22 @@ void lmb_down_cb( int x, int y, PVOID userData )
   }
 
   UINT id;
+  UINT idx = CAGD_NO_INDEX;
 
-  for( cagdPick( x, y ); id = cagdPickNext();)
+  for( cagdPick( x, y ); id = cagdPickNextIndex( &idx );)
   {
-    if( cagdGetSegmentType( id ) == CAGD_SEGMENT_POINT )
+    if( cagdGetSegmentType( id ) == CAGD_SEGMENT_POINTS )
       break;
   }
 
   if( id )
+  {
     set_active_pt_id( id );
+    set_active_pt_idx( idx );
+    cagdGetVertex( id, idx, &drag_start_pnt );
+  }
+  else if( active_lmb_curve != nullptr )
+    hist_record( active_lmb_curve ); // whole curve drag, committed on lmb up
 }
 
 /******************************************************************************
@@ -838,13 +1013,31 @@ void lmb_down_cb( int x, int y, PVOID userData )
 ******************************************************************************/
 void lmb_up_cb( int x, int y, PVOID userData )
 {
+  int drag_pt_id = get_active_pt_id();
+
+  if( drag_pt_id != K_NOT_USED )
+  {
+    CAGD_POINT drag_end_pnt;
+
+    if( cagdGetVertex( drag_pt_id, get_active_pt_idx(), &drag_end_pnt ) )
+    {
+      hist_record_drag( get_pnt_crv( drag_pt_id ),
+                        get_active_pt_idx(),
+                        drag_start_pnt,
+                        drag_end_pnt );
+    }
+  }
+
+  hist_commit();
   set_active_pt_id( K_NOT_USED );
 
   if( add_bezier_is_active && add_bezier_active_crv != nullptr )
   {
     CAGD_POINT wc_p = screen_to_world_coord( x, y );
     int num_ctrl_pts = add_bezier_active_crv->ctrl_pnts_.size();
+    hist_record( add_bezier_active_crv );
     add_bezier_active_crv->add_ctrl_pnt( wc_p, num_ctrl_pts );
+    hist_commit();
     add_bezier_active_crv->show_ctrl_poly();
     add_bezier_active_crv->show_crv();
     cagdRedraw();
@@ -853,9 +1046,11 @@ void lmb_up_cb( int x, int y, PVOID userData )
   {
     CAGD_POINT wc_p = screen_to_world_coord( x, y );
     int num_ctrl_pts = add_bspline_active_crv->ctrl_pnts_.size();
+    hist_record( add_bspline_active_crv );
     add_bspline_active_crv->add_ctrl_pnt( wc_p, num_ctrl_pts );
     add_bspline_active_crv->makeUniformKnotVector( true, 0.0, 1.0 );
     add_bspline_active_crv->makeOpenKnotVector();
+    hist_commit();
     add_bspline_active_crv->show_ctrl_poly();
     add_bspline_active_crv->show_crv();
     cagdRedraw();
@@ -915,15 +1110,20 @@ void rmb_up_cb( int x, int y, PVOID userData )
   }
 
   UINT id;
+  UINT idx = CAGD_NO_INDEX;
   UINT pt_id = K_NOT_USED;
+  UINT pt_idx = CAGD_NO_INDEX;
   UINT polyline_id = K_NOT_USED;
   Curve *crv = nullptr;
-  std::tuple< int, int > neibor_pts = std::make_tuple( K_NOT_USED, K_NOT_USED );
+  Curve *ctrl_crv = nullptr;
 
-  for( cagdPick( x, y ); id = cagdPickNext();)
+  for( cagdPick( x, y ); id = cagdPickNextIndex( &idx );)
   {
-    if( cagdGetSegmentType( id ) == CAGD_SEGMENT_POINT )
+    if( cagdGetSegmentType( id ) == CAGD_SEGMENT_POINTS )
+    {
       pt_id = id;
+      pt_idx = idx;
+    }
     if( cagdGetSegmentType( id ) == CAGD_SEGMENT_POLYLINE )
       polyline_id = id;
 
@@ -937,12 +1137,13 @@ void rmb_up_cb( int x, int y, PVOID userData )
   if( polyline_id != K_NOT_USED )
   {
     crv = get_seg_crv( polyline_id );
-    neibor_pts = get_ctrl_seg_pnts( polyline_id );
+    ctrl_crv = get_ctrl_seg_crv( polyline_id );
   }
 
   if( pt_id != K_NOT_USED ) // RMB on ctrl pt
   {
     active_pnt_id = pt_id;
+    active_pnt_idx = pt_idx;
     active_rmb_curve = get_pnt_crv( pt_id );
     show_rmb_on_ctrl_pt_menu( x, y );
   }
@@ -952,12 +1153,19 @@ void rmb_up_cb( int x, int y, PVOID userData )
     active_rmb_curve = crv;
     show_rmb_on_curve_menu( x, y );
   }
-  else if( std::get< 0 >( neibor_pts ) != K_NOT_USED && // RMB on control points polyline
-           std::get< 1 >( neibor_pts ) != K_NOT_USED )
+  else if( ctrl_crv != nullptr ) // RMB on control points polyline
   {
-    active_rmb_curve = get_pnt_crv( std::get< 1 >( neibor_pts ) );
-    active_rmb_ctrl_polyline = polyline_id;
-    show_rmb_on_ctrl_polyline_menu( x, y );
+    UINT edge = cagdGetNearestEdge( polyline_id, x, y );
+
+    if( edge != 0 )
+    {
+      active_rmb_curve = ctrl_crv;
+      active_rmb_ctrl_polyline = polyline_id;
+      active_rmb_ctrl_edge = edge;
+      show_rmb_on_ctrl_polyline_menu( x, y );
+    }
+    else
+      show_no_selection_rmb_menu( x, y );
   }
   else
     show_no_selection_rmb_menu( x, y );
@@ -1004,12 +1212,18 @@ void show_rmb_on_curve_menu( int x, int y )
   AppendMenu( rmb_menu, MF_STRING, CAGD_CONNECT_C0, TEXT( "Connect C0" ) );
   AppendMenu( rmb_menu, MF_STRING, CAGD_CONNECT_C1, TEXT( "Connect C1" ) );
   AppendMenu( rmb_menu, MF_STRING, CAGD_CONNECT_G1, TEXT( "Connect G1" ) );
+  AppendMenu( rmb_menu, MF_SEPARATOR, 0, NULL );
+  AppendMenu( rmb_menu, MF_STRING, CAGD_ELEVATE_DEGREE, TEXT( "Elevate Degree" ) );
+
+  if( active_rmb_curve->order_ > 2 )
+    AppendMenu( rmb_menu, MF_STRING, CAGD_REDUCE_DEGREE, TEXT( "Reduce Degree" ) );
 
   if( crv_type == CurveType::BSPLINE )
   {
     AppendMenu( rmb_menu, MF_SEPARATOR, 0, NULL );
     AppendMenu( rmb_menu, MF_STRING, CAGD_MOD_KNOTS, TEXT( "Modify Knots" ) );
     AppendMenu( rmb_menu, MF_STRING, CAGD_ADD_KNOT, TEXT( "Insert Knot" ) );
+    AppendMenu( rmb_menu, MF_STRING, CAGD_REDUCE_KNOTS, TEXT( "Reduce Knots" ) );
 
     BSpline *bspline = ( BSpline * )active_rmb_curve;
 
@@ -1072,6 +1286,7 @@ void show_no_selection_rmb_menu( int x, int y )
   CheckMenuItem( rmb_menu, CAGD_HIDE_CTRL_POLYS, get_hide_ctrl_polys() ? MF_CHECKED : MF_UNCHECKED );
 
   AppendMenu( rmb_menu, MF_SEPARATOR, 0, NULL );
+  AppendMenu( rmb_menu, MF_STRING, CAGD_REDUCE_ALL_KNOTS, TEXT( "Reduce All Knots" ) );
   AppendMenu( rmb_menu, MF_STRING, CAGD_CLEAN_ALL, TEXT( "Clean All" ) );
 
   TrackPopupMenu( rmb_menu, TPM_RIGHTBUTTON, pt.x, pt.y, 0, hWnd, NULL );
@@ -1085,9 +1300,11 @@ void clean_active_rmb_data()
 {
   active_rmb_curve = nullptr;
   active_rmb_ctrl_polyline = K_NOT_USED;
+  active_rmb_ctrl_edge = K_NOT_USED;
   cur_rmb_screen_pick[0] = K_NOT_USED;
   cur_rmb_screen_pick[1] = K_NOT_USED;
   hilited_pt_id = K_NOT_USED;
+  hilited_pt_idx = K_NOT_USED;
 }
 
 /******************************************************************************
@@ -1096,28 +1313,32 @@ void clean_active_rmb_data()
 void mouse_move_cb( int x, int y, PVOID userData )
 {
   int id = K_NOT_USED;
+  UINT idx = CAGD_NO_INDEX;
 
-  for( cagdPick( x, y ); id = cagdPickNext();)
+  for( cagdPick( x, y ); id = cagdPickNextIndex( &idx );)
   {
-    if( cagdGetSegmentType( id ) == CAGD_SEGMENT_POINT )
+    if( cagdGetSegmentType( id ) == CAGD_SEGMENT_POINTS )
       break;
   }
 
+  if( hilited_pt_id != K_NOT_USED &&
+      ( hilited_pt_id != id || hilited_pt_idx != ( int )idx ) )
+  {
+    cagdResetPointColor( hilited_pt_id, hilited_pt_idx );
+    cagdRedraw();
+  }
+
   if( id > 0 )
   {
-    cagdSetSegmentColor( id, 255, 255, 0 );
+    cagdSetPointColor( id, idx, 255, 255, 0 );
     cagdRedraw();
     hilited_pt_id = id;
+    hilited_pt_idx = idx;
   }
   else
   {
-    if( hilited_pt_id != K_NOT_USED )
-    {
-      cagdSetSegmentColor( hilited_pt_id, 0, 255, 0 );
-      cagdRedraw();
-    }
-
     hilited_pt_id = K_NOT_USED;
+    hilited_pt_idx = K_NOT_USED;
   }
 }
 
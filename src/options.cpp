@@ -1,56 +1,77 @@
 #include "options.h"
+#include "scene.h"
 
-// Define the variables
-unsigned int DEF_NUM_STEPS = NUM_SAMPS;
-unsigned int DEF_DEGREE = 3;
-unsigned char CURVE_COLOR[ 3 ] = { 255, 0, 0 };
-bool HIDE_CTRL_POLYS = false;
+// the settings live in the selected scene
+static SceneOptions &opts()
+{
+  return get_scene()->opts;
+}
 
 const unsigned char *get_curve_color()
 {
-  return CURVE_COLOR;
+  return opts().curve_color;
 }
 
 void set_curve_color( unsigned char new_curve_color[ 3 ] )
 {
-  CURVE_COLOR[ 0 ] = new_curve_color[ 0 ];
-  CURVE_COLOR[ 1 ] = new_curve_color[ 1 ];
-  CURVE_COLOR[ 2 ] = new_curve_color[ 2 ];
+  opts().curve_color[ 0 ] = new_curve_color[ 0 ];
+  opts().curve_color[ 1 ] = new_curve_color[ 1 ];
+  opts().curve_color[ 2 ] = new_curve_color[ 2 ];
 }
 
 void get_curve_color( unsigned char *red, unsigned char *green, unsigned char *blue )
 {
-  *red   = CURVE_COLOR[0];
-  *green = CURVE_COLOR[1];
-  *blue  = CURVE_COLOR[2];
+  *red   = opts().curve_color[0];
+  *green = opts().curve_color[1];
+  *blue  = opts().curve_color[2];
 }
 
 unsigned int get_def_degree()
 {
-  return DEF_DEGREE;
+  return opts().def_degree;
 }
 
 void set_def_degree( unsigned int val )
 {
-  DEF_DEGREE = val;
+  opts().def_degree = val;
 }
 
 unsigned int get_default_num_steps()
 {
-  return DEF_NUM_STEPS;
+  return opts().num_steps;
 }
 
 void set_default_num_steps( unsigned int val )
 {
-  DEF_NUM_STEPS = val;
+  opts().num_steps = val;
 }
 
 void set_hide_ctrl_polys( bool hide )
 {
-  HIDE_CTRL_POLYS = hide;
+  opts().hide_ctrl_polys = hide;
 }
 
 bool get_hide_ctrl_polys()
 {
-  return HIDE_CTRL_POLYS;
+  return opts().hide_ctrl_polys;
+}
+
+void set_pack_saves( bool pack )
+{
+  opts().pack_saves = pack;
+}
+
+bool get_pack_saves()
+{
+  return opts().pack_saves;
+}
+
+void set_pack_tol( double tol )
+{
+  opts().pack_tol = tol;
+}
+
+double get_pack_tol()
+{
+  return opts().pack_tol;
 }
@@ -0,0 +1,546 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "paged_scene.h"
+#include "crv_binary.h"
+#include "crv_utils.h"
+#include "BSpline.h"
+#include "mapped_file.h"
+#include "options.h"
+#include "scene.h"
+
+enum
+{ /* paged curve states */
+  K_PAGE_OUT = 0,
+  K_PAGE_IN,
+  K_PAGE_PINNED, // edited, stays in the scene
+  K_PAGE_GONE    // removed or corrupt
+};
+
+struct PagedCurve
+{
+  double min_x;
+  double min_y;
+  double max_x;
+  double max_y;
+  Curve *p_crv; // while paged in
+  SlotHandle handle;
+  uint64_t last_seen; // view update it was last in view
+  uint32_t cost;
+  uint8_t state;
+};
+
+struct PagedScene
+{
+  std::unique_ptr< MappedFile > p_file;
+  CagdbView view;
+  Scene *p_scene;
+  std::vector< PagedCurve > crvs;
+
+  // grid over the bounding box of all curves, the curves of cell i are
+  // cell_crvs[ cell_start[ i ] .. cell_start[ i + 1 ] )
+  double min_x;
+  double min_y;
+  double cell_w;
+  double cell_h;
+  std::vector< uint32_t > cell_start;
+  std::vector< uint32_t > cell_crvs;
+  std::vector< uint32_t > big_crvs;
+
+  std::vector< uint32_t > resident;
+  uint64_t resident_cost;
+  uint64_t stamp;
+};
+
+static std::unique_ptr< PagedScene > g_p_paged;
+
+/******************************************************************************
+* is_paged_file_path
+******************************************************************************/
+bool is_paged_file_path( const std::string &file_path )
+{
+  if( !is_binary_file_path( file_path ) )
+    return false;
+
+  std::ifstream ifs( file_path, std::ios::binary | std::ios::ate );
+
+  return ifs && ( uint64_t )ifs.tellg() >= K_PAGED_MIN_FILE_SIZE;
+}
+
+/******************************************************************************
+* compute_box
+******************************************************************************/
+// the control polygon contains the curve for positive weights
+static bool compute_box( const CagdbView &view, uint32_t idx, PagedCurve &crv )
+{
+  const CagdbCurve &entry = view.dir[ idx ];
+  const double *pnts = view.pnts + 3 * entry.first_pnt;
+
+  crv.min_x = crv.min_y = HUGE_VAL;
+  crv.max_x = crv.max_y = -HUGE_VAL;
+
+  for( uint32_t i = 0; i < entry.num_pnts; ++i )
+  {
+    double w = pnts[ 3 * i + 2 ];
+    double x = pnts[ 3 * i ] / w;
+    double y = pnts[ 3 * i + 1 ] / w;
+
+    if( !std::isfinite( x ) || !std::isfinite( y ) )
+      return false;
+
+    crv.min_x = min( crv.min_x, x );
+    crv.min_y = min( crv.min_y, y );
+    crv.max_x = max( crv.max_x, x );
+    crv.max_y = max( crv.max_y, y );
+  }
+
+  return entry.num_pnts > 0;
+}
+
+/******************************************************************************
+* get_cell_range
+******************************************************************************/
+static void get_cell_range( const PagedScene &paged,
+                            double min_x,
+                            double min_y,
+                            double max_x,
+                            double max_y,
+                            int range[ 4 ] )
+{
+  double coords[ 4 ] = { ( min_x - paged.min_x ) / paged.cell_w,
+                         ( min_y - paged.min_y ) / paged.cell_h,
+                         ( max_x - paged.min_x ) / paged.cell_w,
+                         ( max_y - paged.min_y ) / paged.cell_h };
+
+  for( int i = 0; i < 4; ++i )
+  {
+    double coord = min( max( coords[ i ], 0.0 ), ( double )( K_PAGED_GRID_DIM - 1 ) );
+    range[ i ] = ( int )coord;
+  }
+}
+
+/******************************************************************************
+* build_grid
+******************************************************************************/
+static void build_grid( PagedScene &paged )
+{
+  double max_x = -HUGE_VAL;
+  double max_y = -HUGE_VAL;
+
+  paged.min_x = paged.min_y = HUGE_VAL;
+
+  for( auto &crv : paged.crvs )
+  {
+    if( crv.state == K_PAGE_GONE )
+      continue;
+
+    paged.min_x = min( paged.min_x, crv.min_x );
+    paged.min_y = min( paged.min_y, crv.min_y );
+    max_x = max( max_x, crv.max_x );
+    max_y = max( max_y, crv.max_y );
+  }
+
+  if( paged.min_x > max_x )
+    paged.min_x = paged.min_y = max_x = max_y = 0.0;
+
+  paged.cell_w = max( ( max_x - paged.min_x ) / K_PAGED_GRID_DIM, 1e-12 );
+  paged.cell_h = max( ( max_y - paged.min_y ) / K_PAGED_GRID_DIM, 1e-12 );
+  paged.cell_start.assign( K_PAGED_GRID_DIM * K_PAGED_GRID_DIM + 1, 0 );
+
+  // count, then fill
+  for( int pass = 0; pass < 2; ++pass )
+  {
+    std::vector< uint32_t > fill;
+
+    if( pass == 1 )
+    {
+      for( size_t i = 1; i < paged.cell_start.size(); ++i )
+        paged.cell_start[ i ] += paged.cell_start[ i - 1 ];
+
+      paged.cell_crvs.resize( paged.cell_start.back() );
+      fill.assign( paged.cell_start.begin(), paged.cell_start.end() - 1 );
+    }
+
+    for( uint32_t idx = 0; idx < paged.crvs.size(); ++idx )
+    {
+      const PagedCurve &crv = paged.crvs[ idx ];
+      int range[ 4 ];
+
+      if( crv.state == K_PAGE_GONE )
+        continue;
+
+      get_cell_range( paged, crv.min_x, crv.min_y, crv.max_x, crv.max_y, range );
+
+      if( ( range[ 2 ] - range[ 0 ] + 1 ) * ( range[ 3 ] - range[ 1 ] + 1 ) > K_PAGED_MAX_CELLS )
+      {
+        if( pass == 0 )
+          paged.big_crvs.push_back( idx );
+
+        continue;
+      }
+
+      for( int y = range[ 1 ]; y <= range[ 3 ]; ++y )
+      {
+        for( int x = range[ 0 ]; x <= range[ 2 ]; ++x )
+        {
+          int cell = y * K_PAGED_GRID_DIM + x;
+
+          if( pass == 0 )
+            ++paged.cell_start[ cell + 1 ];
+          else
+            paged.cell_crvs[ fill[ cell ]++ ] = idx;
+        }
+      }
+    }
+  }
+}
+
+/******************************************************************************
+* get_view_box
+******************************************************************************/
+// where the window corners meet the XY plane, false if the view does not
+// look at the plane
+static bool get_view_box( double box[ 4 ] )
+{
+  RECT rect;
+
+  if( !GetClientRect( cagdGetWindow(), &rect ) )
+    return false;
+
+  int xs[ 2 ] = { rect.left, rect.right };
+  int ys[ 2 ] = { rect.top, rect.bottom };
+
+  box[ 0 ] = box[ 1 ] = HUGE_VAL;
+  box[ 2 ] = box[ 3 ] = -HUGE_VAL;
+
+  for( int i = 0; i < 2; ++i )
+  {
+    for( int j = 0; j < 2; ++j )
+    {
+      CAGD_POINT pnt = screen_to_world_coord( xs[ i ], ys[ j ] );
+
+      if( !std::isfinite( pnt.x ) || !std::isfinite( pnt.y ) )
+        return false;
+
+      box[ 0 ] = min( box[ 0 ], pnt.x );
+      box[ 1 ] = min( box[ 1 ], pnt.y );
+      box[ 2 ] = max( box[ 2 ], pnt.x );
+      box[ 3 ] = max( box[ 3 ], pnt.y );
+    }
+  }
+
+  return true;
+}
+
+/******************************************************************************
+* is_crv_edited
+******************************************************************************/
+static bool is_crv_edited( const PagedScene &paged, uint32_t idx, const Curve *p_crv )
+{
+  const CagdbView &view = paged.view;
+  const CagdbCurve &entry = view.dir[ idx ];
+  const double *pnts = view.pnts + 3 * entry.first_pnt;
+
+  if( p_crv->order_ != view.orders[ idx ] || p_crv->ctrl_pnts_.size() != entry.num_pnts )
+    return true;
+
+  for( uint32_t i = 0; i < entry.num_pnts; ++i )
+  {
+    const CAGD_POINT &pnt = p_crv->ctrl_pnts_[ i ];
+    double w = pnts[ 3 * i + 2 ];
+
+    if( pnt.x != pnts[ 3 * i ] / w || pnt.y != pnts[ 3 * i + 1 ] / w || pnt.z != w )
+      return true;
+  }
+
+  if( p_crv->kind_ == CurveType::BSPLINE )
+  {
+    const double_vec &knots = static_cast< const BSpline * >( p_crv )->knots_;
+
+    if( knots.size() != entry.num_knots ||
+        !std::equal( knots.begin(), knots.end(), view.knots + entry.first_knot ) )
+      return true;
+  }
+
+  return memcmp( p_crv->color_, view.colors + 4 * idx, sizeof( p_crv->color_ ) ) != 0;
+}
+
+/******************************************************************************
+* drop_stale
+******************************************************************************/
+// forgets the resident curves that were removed or edited since the last
+// update
+static void drop_stale( PagedScene &paged )
+{
+  SlotMap< Curve * > &scene_crvs = paged.p_scene->curves;
+  size_t num_kept = 0;
+
+  for( auto idx : paged.resident )
+  {
+    PagedCurve &crv = paged.crvs[ idx ];
+
+    if( !scene_crvs.contains( crv.handle ) )
+      crv.state = K_PAGE_GONE;
+    else if( is_crv_edited( paged, idx, crv.p_crv ) )
+      crv.state = K_PAGE_PINNED;
+    else
+    {
+      paged.resident[ num_kept++ ] = idx;
+      continue;
+    }
+
+    crv.p_crv = nullptr;
+    paged.resident_cost -= crv.cost;
+  }
+
+  paged.resident.resize( num_kept );
+}
+
+/******************************************************************************
+* evict
+******************************************************************************/
+// evicts the least recently seen curves out of view until need more fits
+static void evict( PagedScene &paged, uint64_t need )
+{
+  if( paged.resident_cost + need <= K_PAGED_BUDGET )
+    return;
+
+  std::sort( paged.resident.begin(), paged.resident.end(), [ &paged ]( uint32_t a, uint32_t b )
+  {
+    return paged.crvs[ a ].last_seen > paged.crvs[ b ].last_seen;
+  } );
+
+  while( !paged.resident.empty() && paged.resident_cost + need > K_PAGED_BUDGET )
+  {
+    PagedCurve &crv = paged.crvs[ paged.resident.back() ];
+
+    if( crv.last_seen == paged.stamp )
+      break;
+
+    free_crv( crv.p_crv );
+    crv.p_crv = nullptr;
+    crv.handle = K_NO_HANDLE;
+    crv.state = K_PAGE_OUT;
+    paged.resident_cost -= crv.cost;
+    paged.resident.pop_back();
+  }
+}
+
+/******************************************************************************
+* visit_crv
+******************************************************************************/
+static void visit_crv( PagedScene &paged,
+                       uint32_t idx,
+                       const double box[ 4 ],
+                       std::vector< uint32_t > &new_idxs,
+                       uint64_t &need )
+{
+  PagedCurve &crv = paged.crvs[ idx ];
+
+  if( crv.last_seen == paged.stamp || crv.state == K_PAGE_GONE || crv.state == K_PAGE_PINNED ||
+      crv.max_x < box[ 0 ] || crv.min_x > box[ 2 ] ||
+      crv.max_y < box[ 1 ] || crv.min_y > box[ 3 ] )
+    return;
+
+  if( crv.state == K_PAGE_OUT )
+  {
+    // what does not fit stays out until the view gets closer
+    if( need > 0 && need + crv.cost > K_PAGED_BUDGET )
+      return;
+
+    new_idxs.push_back( idx );
+    need += crv.cost;
+  }
+
+  crv.last_seen = paged.stamp;
+}
+
+/******************************************************************************
+* update_residency
+******************************************************************************/
+static void update_residency()
+{
+  PagedScene &paged = *g_p_paged;
+  double box[ 4 ];
+  int range[ 4 ];
+
+  // only the scene the file was opened in is paged
+  if( get_scene() != paged.p_scene )
+    return;
+
+  if( !get_view_box( box ) )
+  {
+    box[ 0 ] = box[ 1 ] = -HUGE_VAL;
+    box[ 2 ] = box[ 3 ] = HUGE_VAL;
+  }
+
+  ++paged.stamp;
+  drop_stale( paged );
+
+  std::vector< uint32_t > new_idxs;
+  uint64_t need = 0;
+
+  get_cell_range( paged, box[ 0 ], box[ 1 ], box[ 2 ], box[ 3 ], range );
+
+  for( auto idx : paged.big_crvs )
+    visit_crv( paged, idx, box, new_idxs, need );
+
+  for( int y = range[ 1 ]; y <= range[ 3 ] && need < K_PAGED_BUDGET; ++y )
+  {
+    for( int x = range[ 0 ]; x <= range[ 2 ] && need < K_PAGED_BUDGET; ++x )
+    {
+      int cell = y * K_PAGED_GRID_DIM + x;
+
+      for( uint32_t i = paged.cell_start[ cell ]; i < paged.cell_start[ cell + 1 ]; ++i )
+        visit_crv( paged, paged.cell_crvs[ i ], box, new_idxs, need );
+    }
+  }
+
+  evict( paged, need );
+
+  std::vector< Curve * > new_crvs;
+
+  new_crvs.reserve( new_idxs.size() );
+
+  for( auto idx : new_idxs )
+  {
+    PagedCurve &crv = paged.crvs[ idx ];
+
+    // resident curves in view are not evicted, what still does not fit waits
+    if( paged.resident_cost > 0 && paged.resident_cost + crv.cost > K_PAGED_BUDGET )
+      continue;
+
+    crv.p_crv = build_cagdb_curve( paged.view, idx );
+    crv.state = K_PAGE_IN;
+    paged.resident.push_back( idx );
+    paged.resident_cost += crv.cost;
+    new_crvs.push_back( crv.p_crv );
+  }
+
+  if( !new_crvs.empty() )
+  {
+    register_crvs( new_crvs );
+
+    for( auto idx : new_idxs )
+    {
+      PagedCurve &crv = paged.crvs[ idx ];
+
+      if( crv.state == K_PAGE_IN && crv.p_crv != nullptr )
+        crv.handle = crv.p_crv->handle_;
+    }
+  }
+
+  cagdRedraw();
+}
+
+/******************************************************************************
+* view_changed
+******************************************************************************/
+static void view_changed( int, int, void * )
+{
+  if( g_p_paged != nullptr )
+    update_residency();
+}
+
+/******************************************************************************
+* paged_scene_open
+******************************************************************************/
+bool paged_scene_open( const std::string &file_path )
+{
+  paged_scene_close();
+
+  std::unique_ptr< PagedScene > p_paged( new PagedScene() );
+
+  p_paged->p_file.reset( new MappedFile( file_path ) );
+
+  if( !p_paged->p_file->is_mapped() )
+  {
+    print_error( "Error opening file" );
+    return false;
+  }
+
+  if( !get_cagdb_view( *p_paged->p_file, p_paged->view ) )
+    return false;
+
+  if( p_paged->view.p_header->flags & K_CAGDB_PACKED )
+  {
+    print_error( "Packed files cannot be paged" );
+    return false;
+  }
+
+  uint32_t num_crvs = p_paged->view.p_header->num_crvs;
+  uint32_t num_samples = get_default_num_steps();
+
+  p_paged->p_scene = get_scene();
+  p_paged->crvs.resize( num_crvs );
+  p_paged->resident_cost = 0;
+  p_paged->stamp = 0;
+
+  for( uint32_t i = 0; i < num_crvs; ++i )
+  {
+    PagedCurve &crv = p_paged->crvs[ i ];
+
+    crv.p_crv = nullptr;
+    crv.handle = K_NO_HANDLE;
+    crv.last_seen = 0;
+    crv.state = K_PAGE_OUT;
+
+    if( !is_cagdb_curve_valid( p_paged->view, i ) || !compute_box( p_paged->view, i, crv ) )
+    {
+      crv.state = K_PAGE_GONE;
+      continue;
+    }
+
+    crv.cost = p_paged->view.dir[ i ].num_pnts + num_samples;
+  }
+
+  build_grid( *p_paged );
+
+  printf( "Paging %u curves, %zu in the grid and %zu large\n",
+          num_crvs,
+          p_paged->cell_crvs.size(),
+          p_paged->big_crvs.size() );
+
+  g_p_paged = std::move( p_paged );
+  cagdRegisterCallback( CAGD_VIEWCHANGE, view_changed, NULL );
+  update_residency();
+
+  return true;
+}
+
+/******************************************************************************
+* paged_scene_close
+******************************************************************************/
+void paged_scene_close()
+{
+  if( g_p_paged == nullptr )
+    return;
+
+  cagdRegisterCallback( CAGD_VIEWCHANGE, NULL, NULL );
+
+  Scene *p_prev = scene_select( g_p_paged->p_scene );
+
+  // edited curves stay in the scene
+  drop_stale( *g_p_paged );
+
+  for( auto idx : g_p_paged->resident )
+    free_crv( g_p_paged->crvs[ idx ].p_crv );
+
+  scene_select( p_prev );
+  g_p_paged.reset();
+  cagdRedraw();
+}
+
+/******************************************************************************
+* paged_scene_is_open
+******************************************************************************/
+bool paged_scene_is_open()
+{
+  return g_p_paged != nullptr && g_p_paged->p_scene == get_scene();
+}
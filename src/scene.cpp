@@ -0,0 +1,85 @@
+#include <stdexcept>
+
+#include "scene.h"
+#include "options.h"
+#include "history.h"
+#include "crv_utils.h"
+
+static Scene def_scene;
+static thread_local Scene *cur_scene = &def_scene;
+
+/******************************************************************************
+* Scene::Scene
+******************************************************************************/
+Scene::Scene() :
+  opts{ NUM_SAMPS, 3, { 255, 0, 0 }, false, false, DEF_PACK_TOL },
+  hist( hist_create() ),
+  segs( nullptr )
+{
+}
+
+/******************************************************************************
+* Scene::~Scene
+******************************************************************************/
+Scene::~Scene()
+{
+  hist_destroy( hist );
+}
+
+/******************************************************************************
+* scene_create
+******************************************************************************/
+Scene *scene_create()
+{
+  Scene *p_scene = new Scene();
+
+  // new scenes start with the settings of the selected one
+  p_scene->opts = get_scene()->opts;
+  p_scene->segs = cagdCreateSegTable();
+
+  if( p_scene->segs == nullptr )
+  {
+    delete p_scene;
+    throw std::runtime_error( "failed to create segment table" );
+  }
+
+  return p_scene;
+}
+
+/******************************************************************************
+* scene_destroy
+******************************************************************************/
+void scene_destroy( Scene *p_scene )
+{
+  if( p_scene == nullptr || p_scene == &def_scene )
+    return;
+
+  Scene *p_prev = scene_select( p_scene );
+
+  clean_all_curves();
+  scene_select( p_prev == p_scene ? nullptr : p_prev );
+
+  cagdDestroySegTable( p_scene->segs );
+  delete p_scene;
+}
+
+/******************************************************************************
+* scene_select
+******************************************************************************/
+Scene *scene_select( Scene *p_scene )
+{
+  Scene *p_prev = cur_scene;
+
+  cur_scene = p_scene != nullptr ? p_scene : &def_scene;
+  cagdSelectSegTable( cur_scene->segs );
+
+  return p_prev;
+}
+
+/******************************************************************************
+* get_scene
+******************************************************************************/
+Scene *get_scene()
+{
+  return cur_scene;
+}
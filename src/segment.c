@@ -5,6 +5,20 @@
 #include "cagd.h"
 #include "internal.h"
 
+typedef struct
+{ /* vertex storage shared by segments created in one batch */
+  UINT        refs;
+  CAGD_POINT *pnts;
+} VERTEX_BLOCK;
+
+typedef struct
+{ /* faces of a CAGD_SEGMENT_MESH, indices into the segment's vertices */
+  CAGD_POINT *normals;   /* per vertex normal or NULL */
+  UINT       *indices;   /* vertices of all faces back to back */
+  UINT       *faceSizes; /* number of vertices of each face */
+  UINT        nFaces;
+} MESH;
+
 typedef struct
 {
   UINT        crv_type;
@@ -13,29 +27,47 @@ typedef struct
   PSTR        text;
   GLubyte     color_[ 3 ];
   CAGD_POINT *where;
+  GLubyte    *pnt_colors; /* CAGD_SEGMENT_POINTS: per point color or NULL */
+  BYTE       *pnt_flags;  /* CAGD_SEGMENT_POINTS: per point overrides or NULL */
+  VERTEX_BLOCK *block;    /* owner of where if it is shared, NULL otherwise */
+  MESH       *mesh;       /* CAGD_SEGMENT_MESH: faces over where, NULL otherwise */
 } SEGMENT;
 
-static GLubyte color_[] = { 255, 255, 255 };
-static UINT nSegments = 0;
-static SEGMENT *list = NULL;
+enum
+{ /* per point overrides of CAGD_SEGMENT_POINTS */
+  PNT_COLORED = 1,
+  PNT_HIDDEN = 2
+};
+
+struct SEG_TABLE
+{ /* everything the segment functions below work on */
+  GLubyte  color[ 3 ];
+  UINT     nSegments;
+  UINT     nUsed;
+  UINT     firstFree; /* no unused segment below this id */
+  SEGMENT *list;
+};
+
+static CAGD_SEG_TABLE defTable = { { 255, 255, 255 }, 0, 0, 1, NULL };
+static __declspec( thread ) CAGD_SEG_TABLE *table = &defTable; /* selected table */
 
 static BOOL valid( UINT id )
 {
-  return ( id < nSegments ) && ( list[ id ].crv_type != CAGD_SEGMENT_UNUSED );
+  return ( id < table->nSegments ) && ( table->list[ id ].crv_type != CAGD_SEGMENT_UNUSED );
 }
 
 void cagdSetColor( BYTE red, BYTE green, BYTE blue )
 {
-  color_[ 0 ] = red;
-  color_[ 1 ] = green;
-  color_[ 2 ] = blue;
+  table->color[ 0 ] = red;
+  table->color[ 1 ] = green;
+  table->color[ 2 ] = blue;
 }
 
 void cagdGetColor( BYTE *red, BYTE *green, BYTE *blue )
 {
-  *red = color_[ 0 ];
-  *green = color_[ 1 ];
-  *blue = color_[ 2 ];
+  *red = table->color[ 0 ];
+  *green = table->color[ 1 ];
+  *blue = table->color[ 2 ];
 }
 
 BOOL cagdSetSegmentColor( UINT id, BYTE red, BYTE green, BYTE blue )
@@ -43,7 +75,7 @@ BOOL cagdSetSegmentColor( UINT id, BYTE red, BYTE green, BYTE blue )
   SEGMENT *segment;
   if( !valid( id ) )
     return FALSE;
-  segment = &list[ id ];
+  segment = &table->list[ id ];
   segment->color_[ 0 ] = red;
   segment->color_[ 1 ] = green;
   segment->color_[ 2 ] = blue;
@@ -55,50 +87,184 @@ BOOL cagdGetSegmentColor( UINT id, BYTE *red, BYTE *green, BYTE *blue )
   SEGMENT *segment;
   if( !valid( id ) )
     return FALSE;
-  segment = &list[ id ];
+  segment = &table->list[ id ];
   *red = segment->color_[ 0 ];
   *green = segment->color_[ 1 ];
   *blue = segment->color_[ 2 ];
   return TRUE;
 }
 
+static BOOL growSegments( UINT count )
+{
+  UINT id, n = table->nSegments ? table->nSegments : 20;
+  SEGMENT *tmp;
+  if( count <= table->nSegments )
+    return TRUE;
+  while( n < count )
+    n *= 2;
+  tmp = ( SEGMENT * )realloc( table->list, sizeof( SEGMENT ) * n );
+  if( tmp == NULL )
+    return FALSE;
+  table->list = tmp;
+  for( id = table->nSegments; id < n; id++ )
+  {
+    SEGMENT *segment = &table->list[ id ];
+    segment->crv_type = CAGD_SEGMENT_UNUSED;
+    segment->visible = FALSE;
+    segment->length = 0;
+    segment->text = NULL;
+    segment->where = NULL;
+    segment->pnt_colors = NULL;
+    segment->pnt_flags = NULL;
+    segment->block = NULL;
+    segment->mesh = NULL;
+  }
+  table->nSegments = n;
+  return TRUE;
+}
+
+static BOOL reserveSegments( UINT count )
+{
+  UINT unused = table->nSegments ? table->nSegments - 1 - table->nUsed : 0;
+  if( count <= unused )
+    return TRUE;
+  return growSegments( ( table->nSegments ? table->nSegments : 1 ) + count - unused );
+}
+
 static UINT findUnused()
 {
   UINT id;
-  for( id = 1; id < nSegments; id++ )
-    if( list[ id ].crv_type == CAGD_SEGMENT_UNUSED )
+  for( id = table->firstFree; id < table->nSegments; id++ )
+    if( table->list[ id ].crv_type == CAGD_SEGMENT_UNUSED )
       break;
-  if( nSegments <= id )
-  {
-    SEGMENT *tmp = ( SEGMENT * )realloc( list, sizeof( SEGMENT ) * ( nSegments += 20 ) );
+  if( table->nSegments <= id && !growSegments( id + 1 ) )
+    return 0;
+  table->firstFree = id;
+  return id;
+}
 
-    if( tmp != NULL )
-    {
-      list = tmp;
+static UINT claimUnused( UINT crv_type )
+{
+  UINT id = findUnused();
+  SEGMENT *segment;
+  if( id == 0 )
+    return 0;
+  segment = &table->list[ id ];
+  segment->crv_type = crv_type;
+  segment->visible = TRUE;
+  segment->length = 0;
+  segment->where = NULL;
+  segment->block = NULL;
+  memcpy( segment->color_, table->color, sizeof( GLubyte ) * 3 );
+  table->firstFree = id + 1;
+  table->nUsed++;
+  return id;
+}
 
-      for( id = nSegments - 20; id < nSegments; id++ )
-      {
-        SEGMENT *segment = &list[ id ];
-        segment->crv_type = CAGD_SEGMENT_UNUSED;
-        segment->visible = FALSE;
-        segment->length = 0;
-        segment->text = NULL;
-        segment->where = NULL;
-      }
+static void releaseVertices( SEGMENT *segment )
+{
+  if( segment->block != NULL )
+  {
+    if( --segment->block->refs == 0 )
+    {
+      free( segment->block->pnts );
+      free( segment->block );
     }
+  }
+  else
+    free( segment->where );
+  segment->block = NULL;
+  segment->where = NULL;
+}
 
-    return findUnused();
+static BOOL resizeVertices( SEGMENT *segment, UINT length )
+{
+  CAGD_POINT *tmp;
+  if( segment->length == length )
+    return TRUE;
+  if( segment->block != NULL )
+  { /* a shared block can not grow, give this segment its own storage */
+    tmp = ( CAGD_POINT * )malloc( sizeof( CAGD_POINT ) * length );
+    if( tmp == NULL )
+      return FALSE;
+    releaseVertices( segment );
   }
-  return id;
+  else
+  {
+    tmp = ( CAGD_POINT * )realloc( segment->where, sizeof( CAGD_POINT ) * length );
+    if( tmp == NULL )
+      return FALSE;
+  }
+  segment->where = tmp;
+  segment->length = length;
+  return TRUE;
+}
+
+static VERTEX_BLOCK *allocBlock( UINT length )
+{
+  VERTEX_BLOCK *block = ( VERTEX_BLOCK * )malloc( sizeof( VERTEX_BLOCK ) );
+  if( block == NULL )
+    return NULL;
+  block->refs = 0;
+  block->pnts = ( CAGD_POINT * )malloc( sizeof( CAGD_POINT ) * length );
+  if( block->pnts == NULL )
+  {
+    free( block );
+    return NULL;
+  }
+  return block;
+}
+
+static UINT addSegments( UINT crv_type,
+                         UINT minLength,
+                         const CAGD_POINT *const *where,
+                         const UINT *lengths,
+                         UINT count,
+                         UINT *ids )
+{
+  UINT i, id, nAdded = 0, nValid = 0, total = 0;
+  CAGD_POINT *next;
+  VERTEX_BLOCK *block;
+  for( i = 0; i < count; i++ )
+  {
+    ids[ i ] = 0;
+    if( minLength <= lengths[ i ] )
+    {
+      nValid++;
+      total += lengths[ i ];
+    }
+  }
+  if( nValid == 0 || !reserveSegments( nValid ) )
+    return 0;
+  if( ( block = allocBlock( total ) ) == NULL )
+    return 0;
+  next = block->pnts;
+  for( i = 0; i < count; i++ )
+  {
+    SEGMENT *segment;
+    if( lengths[ i ] < minLength )
+      continue;
+    id = claimUnused( crv_type );
+    segment = &table->list[ id ];
+    memcpy( next, where[ i ], sizeof( CAGD_POINT ) * lengths[ i ] );
+    segment->where = next;
+    segment->length = lengths[ i ];
+    segment->block = block;
+    block->refs++;
+    next += lengths[ i ];
+    ids[ i ] = id;
+    nAdded++;
+  }
+  return nAdded;
 }
 
 UINT cagdAddPoint( const CAGD_POINT *where )
 {
-  UINT id = findUnused();
-  SEGMENT *segment = &list[ id ];
-  segment->crv_type = CAGD_SEGMENT_POINT;
-  segment->visible = TRUE;
-  memcpy( segment->color_, color_, sizeof( GLubyte ) * 3 );
+  UINT id = claimUnused( CAGD_SEGMENT_POINT );
+  SEGMENT *segment;
+  if( id == 0 )
+    return 0;
+  segment = &table->list[ id ];
   segment->where = ( CAGD_POINT * )malloc( sizeof( CAGD_POINT ) );
 
   if( segment->where != NULL )
@@ -114,21 +280,179 @@ BOOL cagdReusePoint( UINT id, const CAGD_POINT *where )
 {
   if( !valid( id ) )
     return FALSE;
-  if( list[ id ].crv_type != CAGD_SEGMENT_POINT )
+  if( table->list[ id ].crv_type != CAGD_SEGMENT_POINT )
+    return FALSE;
+  *table->list[ id ].where = *where;
+  return TRUE;
+}
+
+UINT cagdAddPoints( const CAGD_POINT *where, UINT count, UINT *ids )
+{
+  UINT i;
+  VERTEX_BLOCK *block;
+  for( i = 0; i < count; i++ )
+    ids[ i ] = 0;
+  if( count == 0 || !reserveSegments( count ) )
+    return 0;
+  if( ( block = allocBlock( count ) ) == NULL )
+    return 0;
+  memcpy( block->pnts, where, sizeof( CAGD_POINT ) * count );
+  for( i = 0; i < count; i++ )
+  {
+    SEGMENT *segment;
+    ids[ i ] = claimUnused( CAGD_SEGMENT_POINT );
+    segment = &table->list[ ids[ i ] ];
+    segment->where = &block->pnts[ i ];
+    segment->length = 1;
+    segment->block = block;
+  }
+  block->refs = count;
+  return count;
+}
+
+static void freePointOverrides( SEGMENT *segment )
+{
+  free( segment->pnt_colors );
+  free( segment->pnt_flags );
+  segment->pnt_colors = NULL;
+  segment->pnt_flags = NULL;
+}
+
+static BOOL allocPointOverrides( SEGMENT *segment )
+{
+  if( segment->pnt_flags != NULL )
+    return TRUE;
+  segment->pnt_colors = ( GLubyte * )malloc( sizeof( GLubyte ) * 3 * segment->length );
+  segment->pnt_flags = ( BYTE * )calloc( segment->length, sizeof( BYTE ) );
+  if( segment->pnt_colors == NULL || segment->pnt_flags == NULL )
+  {
+    freePointOverrides( segment );
+    return FALSE;
+  }
+  return TRUE;
+}
+
+UINT cagdAddPointSet( const CAGD_POINT *where, UINT length )
+{
+  UINT id;
+  SEGMENT *segment;
+  if( length < 1 )
+    return 0;
+  if( ( id = claimUnused( CAGD_SEGMENT_POINTS ) ) == 0 )
+    return 0;
+  segment = &table->list[ id ];
+  segment->where = ( CAGD_POINT * )malloc( sizeof( CAGD_POINT ) * length );
+
+  if( segment->where == NULL )
+  {
+    cagdFreeSegment( id );
+    return 0;
+  }
+
+  memcpy( segment->where, where, sizeof( CAGD_POINT ) * length );
+  segment->length = length;
+  return id;
+}
+
+UINT cagdAddPointSets( const CAGD_POINT *const *where,
+                       const UINT *lengths,
+                       UINT count,
+                       UINT *ids )
+{
+  return addSegments( CAGD_SEGMENT_POINTS, 1, where, lengths, count, ids );
+}
+
+BOOL cagdReusePointSet( UINT id, const CAGD_POINT *where, UINT length )
+{
+  SEGMENT *segment;
+  if( length < 1 )
+    return FALSE;
+  if( !valid( id ) )
+    return FALSE;
+  segment = &table->list[ id ];
+  if( segment->crv_type != CAGD_SEGMENT_POINTS )
+    return FALSE;
+  if( segment->length != length )
+  {
+    if( !resizeVertices( segment, length ) )
+      return FALSE;
+
+    freePointOverrides( segment );
+  }
+
+  memcpy( segment->where, where, sizeof( CAGD_POINT ) * length );
+
+  return TRUE;
+}
+
+BOOL cagdSetPointColor( UINT id, UINT index, BYTE red, BYTE green, BYTE blue )
+{
+  SEGMENT *segment;
+  if( !valid( id ) )
+    return FALSE;
+  segment = &table->list[ id ];
+  if( segment->crv_type != CAGD_SEGMENT_POINTS || segment->length <= index )
+    return FALSE;
+  if( !allocPointOverrides( segment ) )
+    return FALSE;
+  segment->pnt_colors[ 3 * index ] = red;
+  segment->pnt_colors[ 3 * index + 1 ] = green;
+  segment->pnt_colors[ 3 * index + 2 ] = blue;
+  segment->pnt_flags[ index ] |= PNT_COLORED;
+  return TRUE;
+}
+
+BOOL cagdResetPointColor( UINT id, UINT index )
+{
+  SEGMENT *segment;
+  if( !valid( id ) )
+    return FALSE;
+  segment = &table->list[ id ];
+  if( segment->crv_type != CAGD_SEGMENT_POINTS || segment->length <= index )
+    return FALSE;
+  if( segment->pnt_flags != NULL )
+    segment->pnt_flags[ index ] &= ~PNT_COLORED;
+  return TRUE;
+}
+
+static BOOL setPointHidden( UINT id, UINT index, BOOL hidden )
+{
+  SEGMENT *segment;
+  if( !valid( id ) )
+    return FALSE;
+  segment = &table->list[ id ];
+  if( segment->crv_type != CAGD_SEGMENT_POINTS || segment->length <= index )
+    return FALSE;
+  if( !hidden && segment->pnt_flags == NULL )
+    return TRUE;
+  if( !allocPointOverrides( segment ) )
     return FALSE;
-  *list[ id ].where = *where;
+  if( hidden )
+    segment->pnt_flags[ index ] |= PNT_HIDDEN;
+  else
+    segment->pnt_flags[ index ] &= ~PNT_HIDDEN;
   return TRUE;
 }
 
+BOOL cagdShowPoint( UINT id, UINT index )
+{
+  return setPointHidden( id, index, FALSE );
+}
+
+BOOL cagdHidePoint( UINT id, UINT index )
+{
+  return setPointHidden( id, index, TRUE );
+}
+
 UINT cagdAddText( const CAGD_POINT *where, PCSTR text )
 {
-  UINT id = findUnused();
-  SEGMENT *segment = &list[ id ];
+  UINT id;
+  SEGMENT *segment;
   if( !text )
     return 0;
-  segment->crv_type = CAGD_SEGMENT_TEXT;
-  segment->visible = TRUE;
-  memcpy( segment->color_, color_, sizeof( GLubyte ) * 3 );
+  if( ( id = claimUnused( CAGD_SEGMENT_TEXT ) ) == 0 )
+    return 0;
+  segment = &table->list[ id ];
   segment->where = ( CAGD_POINT * )malloc( sizeof( CAGD_POINT ) );
 
   if( segment->where != NULL )
@@ -150,7 +474,7 @@ BOOL cagdReuseText( UINT id, const CAGD_POINT *where, PCSTR text )
     return FALSE;
   if( !valid( id ) )
     return FALSE;
-  segment = &list[ id ];
+  segment = &table->list[ id ];
   if( segment->crv_type != CAGD_SEGMENT_TEXT )
     return FALSE;
   *segment->where = *where;
@@ -165,7 +489,7 @@ BOOL cagdGetText( UINT id, PSTR text )
   SEGMENT *segment;
   if( !valid( id ) )
     return FALSE;
-  segment = &list[ id ];
+  segment = &table->list[ id ];
   if( segment->crv_type != CAGD_SEGMENT_TEXT )
     return FALSE;
   strcpy( text, segment->text );
@@ -174,13 +498,13 @@ BOOL cagdGetText( UINT id, PSTR text )
 
 UINT cagdAddPolyline( const CAGD_POINT *where, UINT length )
 {
-  UINT id = findUnused();
-  SEGMENT *segment = &list[ id ];
+  UINT id;
+  SEGMENT *segment;
   if( length < 2 )
     return 0;
-  segment->crv_type = CAGD_SEGMENT_POLYLINE;
-  segment->visible = TRUE;
-  memcpy( segment->color_, color_, sizeof( GLubyte ) * 3 );
+  if( ( id = claimUnused( CAGD_SEGMENT_POLYLINE ) ) == 0 )
+    return 0;
+  segment = &table->list[ id ];
   segment->where = ( CAGD_POINT * )malloc( sizeof( CAGD_POINT ) * length );
 
   if( segment->where != NULL )
@@ -192,6 +516,14 @@ UINT cagdAddPolyline( const CAGD_POINT *where, UINT length )
   return id;
 }
 
+UINT cagdAddPolylines( const CAGD_POINT *const *where,
+                       const UINT *lengths,
+                       UINT count,
+                       UINT *ids )
+{
+  return addSegments( CAGD_SEGMENT_POLYLINE, 2, where, lengths, count, ids );
+}
+
 BOOL cagdReusePolyline( UINT id, const CAGD_POINT *where, UINT length )
 {
   SEGMENT *segment;
@@ -199,19 +531,99 @@ BOOL cagdReusePolyline( UINT id, const CAGD_POINT *where, UINT length )
     return 0;
   if( !valid( id ) )
     return FALSE;
-  segment = &list[ id ];
+  segment = &table->list[ id ];
   if( segment->crv_type != CAGD_SEGMENT_POLYLINE )
     return FALSE;
-  free( segment->where );
+  if( !resizeVertices( segment, length ) )
+    return FALSE;
+
+  memcpy( segment->where, where, sizeof( CAGD_POINT ) * length );
+
+  return TRUE;
+}
+
+static void freeMesh( SEGMENT *segment )
+{
+  if( segment->mesh == NULL )
+    return;
+  free( segment->mesh->normals );
+  free( segment->mesh->indices );
+  free( segment->mesh->faceSizes );
+  free( segment->mesh );
+  segment->mesh = NULL;
+}
+
+static MESH *allocMesh( UINT length, UINT nIndices, UINT nFaces, BOOL hasNormals )
+{
+  MESH *mesh = ( MESH * )calloc( 1, sizeof( MESH ) );
+  if( mesh == NULL )
+    return NULL;
+  mesh->indices = ( UINT * )malloc( sizeof( UINT ) * nIndices );
+  mesh->faceSizes = ( UINT * )malloc( sizeof( UINT ) * nFaces );
+  if( hasNormals )
+    mesh->normals = ( CAGD_POINT * )malloc( sizeof( CAGD_POINT ) * length );
+  if( mesh->indices == NULL || mesh->faceSizes == NULL ||
+      ( hasNormals && mesh->normals == NULL ) )
+  {
+    free( mesh->normals );
+    free( mesh->indices );
+    free( mesh->faceSizes );
+    free( mesh );
+    return NULL;
+  }
+  mesh->nFaces = nFaces;
+  return mesh;
+}
+
+UINT cagdAddMesh( const CAGD_POINT *where,
+                  const CAGD_POINT *normals,
+                  UINT length,
+                  const UINT *indices,
+                  const UINT *faceSizes,
+                  UINT nFaces )
+{
+  UINT id, i, nIndices = 0;
+  SEGMENT *segment;
+  if( length < 1 || nFaces < 1 )
+    return 0;
+  for( i = 0; i < nFaces; i++ )
+    nIndices += faceSizes[ i ];
+  for( i = 0; i < nIndices; i++ )
+    if( length <= indices[ i ] )
+      return 0;
+  if( ( id = claimUnused( CAGD_SEGMENT_MESH ) ) == 0 )
+    return 0;
+  segment = &table->list[ id ];
   segment->where = ( CAGD_POINT * )malloc( sizeof( CAGD_POINT ) * length );
+  segment->mesh = allocMesh( length, nIndices, nFaces, normals != NULL );
 
-  if( segment->where != NULL )
+  if( segment->where == NULL || segment->mesh == NULL )
   {
-    memcpy( segment->where, where, sizeof( CAGD_POINT ) * length );
-    segment->length = length;
+    cagdFreeSegment( id );
+    return 0;
   }
 
-  return TRUE;
+  memcpy( segment->where, where, sizeof( CAGD_POINT ) * length );
+  if( normals != NULL )
+    memcpy( segment->mesh->normals, normals, sizeof( CAGD_POINT ) * length );
+  memcpy( segment->mesh->indices, indices, sizeof( UINT ) * nIndices );
+  memcpy( segment->mesh->faceSizes, faceSizes, sizeof( UINT ) * nFaces );
+  segment->length = length;
+  return id;
+}
+
+UINT cagdGetMeshFaceCount( UINT id )
+{
+  if( !valid( id ) || table->list[ id ].crv_type != CAGD_SEGMENT_MESH )
+    return 0;
+  return table->list[ id ].mesh->nFaces;
+}
+
+static BOOL hasVertices( const SEGMENT *segment )
+{
+  return segment->crv_type == CAGD_SEGMENT_POLYLINE ||
+         segment->crv_type == CAGD_SEGMENT_POINTS ||
+         segment->crv_type == CAGD_SEGMENT_MESH;
 }
 
 BOOL cagdGetVertex( UINT id, UINT vertex, CAGD_POINT *where )
@@ -219,8 +631,8 @@ BOOL cagdGetVertex( UINT id, UINT vertex, CAGD_POINT *where )
   SEGMENT *segment;
   if( !valid( id ) )
     return FALSE;
-  segment = &list[ id ];
-  if( segment->crv_type != CAGD_SEGMENT_POLYLINE )
+  segment = &table->list[ id ];
+  if( !hasVertices( segment ) )
     return FALSE;
   if( segment->length <= vertex )
     return FALSE;
@@ -233,8 +645,8 @@ BOOL cagdSetVertex( UINT id, UINT vertex, const CAGD_POINT *where )
   SEGMENT *segment;
   if( !valid( id ) )
     return FALSE;
-  segment = &list[ id ];
-  if( segment->crv_type != CAGD_SEGMENT_POLYLINE )
+  segment = &table->list[ id ];
+  if( !hasVertices( segment ) )
     return FALSE;
   if( segment->length <= vertex )
     return FALSE;
@@ -246,7 +658,7 @@ BOOL cagdShowSegment( UINT id )
 {
   if( !valid( id ) )
     return FALSE;
-  list[ id ].visible = TRUE;
+  table->list[ id ].visible = TRUE;
   return TRUE;
 }
 
@@ -254,7 +666,7 @@ BOOL cagdHideSegment( UINT id )
 {
   if( !valid( id ) )
     return FALSE;
-  list[ id ].visible = FALSE;
+  table->list[ id ].visible = FALSE;
   return TRUE;
 }
 
@@ -262,7 +674,7 @@ BOOL cagdIsSegmentVisible( UINT id )
 {
   if( !valid( id ) )
     return FALSE;
-  return list[ id ].visible;
+  return table->list[ id ].visible;
 }
 
 BOOL cagdFreeSegment( UINT id )
@@ -270,25 +682,67 @@ BOOL cagdFreeSegment( UINT id )
   SEGMENT *segment;
   if( !valid( id ) )
     return FALSE;
-  segment = &list[ id ];
+  segment = &table->list[ id ];
   if( segment->crv_type == CAGD_SEGMENT_TEXT )
     free( segment->text );
   segment->crv_type = CAGD_SEGMENT_UNUSED;
-  free( segment->where );
+  releaseVertices( segment );
+  freePointOverrides( segment );
+  freeMesh( segment );
+  if( id < table->firstFree )
+    table->firstFree = id;
+  table->nUsed--;
   return TRUE;
 }
 
 void cagdFreeAllSegments()
 {
   UINT id;
-  for( id = 1; id < nSegments; id++ )
+  for( id = 1; id < table->nSegments; id++ )
     cagdFreeSegment( id );
 }
 
+CAGD_SEG_TABLE *cagdCreateSegTable()
+{
+  CAGD_SEG_TABLE *created = ( CAGD_SEG_TABLE * )malloc( sizeof( CAGD_SEG_TABLE ) );
+  if( created == NULL )
+    return NULL;
+  created->color[ 0 ] = created->color[ 1 ] = created->color[ 2 ] = 255;
+  created->nSegments = 0;
+  created->nUsed = 0;
+  created->firstFree = 1;
+  created->list = NULL;
+  return created;
+}
+
+void cagdDestroySegTable( CAGD_SEG_TABLE *destroyed )
+{
+  CAGD_SEG_TABLE *prev;
+  if( destroyed == NULL || destroyed == &defTable )
+    return;
+  prev = cagdSelectSegTable( destroyed );
+  cagdFreeAllSegments();
+  free( destroyed->list );
+  free( destroyed );
+  table = prev == destroyed ? &defTable : prev;
+}
+
+CAGD_SEG_TABLE *cagdSelectSegTable( CAGD_SEG_TABLE *selected )
+{
+  CAGD_SEG_TABLE *prev = table;
+  table = selected ? selected : &defTable;
+  return prev;
+}
+
+CAGD_SEG_TABLE *cagdGetSegTable()
+{
+  return table;
+}
+
 UINT cagdGetSegmentType( UINT id )
 {
-  if( id < nSegments )
-    return list[ id ].crv_type;
+  if( id < table->nSegments )
+    return table->list[ id ].crv_type;
   return CAGD_SEGMENT_UNUSED;
 }
 
@@ -296,7 +750,7 @@ UINT cagdGetSegmentLength( UINT id )
 {
   if( !valid( id ) )
     return 0;
-  return list[ id ].length;
+  return table->list[ id ].length;
 }
 
 BOOL cagdGetSegmentLocation( UINT id, CAGD_POINT *where )
@@ -305,8 +759,8 @@ BOOL cagdGetSegmentLocation( UINT id, CAGD_POINT *where )
   SEGMENT *segment;
   if( !valid( id ) )
     return 0;
-  segment = &list[ id ];
-  if( segment->crv_type == CAGD_SEGMENT_POLYLINE )
+  segment = &table->list[ id ];
+  if( hasVertices( segment ) )
     length = segment->length;
   memcpy( where, segment->where, sizeof( CAGD_POINT ) * length );
   return TRUE;
@@ -319,8 +773,8 @@ UINT cagdGetNearestVertex( UINT id, int x, int y )
   SEGMENT *segment;
   if( !valid( id ) )
     return 0;
-  segment = &list[ id ];
-  if( segment->crv_type != CAGD_SEGMENT_POLYLINE )
+  segment = &table->list[ id ];
+  if( !hasVertices( segment ) )
     return 0;
   for( i = 0; i < segment->length; i++ )
   {
@@ -338,8 +792,66 @@ UINT cagdGetNearestVertex( UINT id, int x, int y )
   return ++minI;
 }
 
-void drawSegments( GLenum mode )
+UINT cagdGetNearestEdge( UINT id, int x, int y )
+{
+  UINT i, minI = 0;
+  int X1, Y1, X2, Y2;
+  double dx, dy, len, t, px, py, d, minD = -1;
+  SEGMENT *segment;
+  if( !valid( id ) )
+    return 0;
+  segment = &table->list[ id ];
+  if( segment->crv_type != CAGD_SEGMENT_POLYLINE || segment->length < 2 )
+    return 0;
+  if( !cagdToWindow( &segment->where[ 0 ], &X1, &Y1 ) )
+    return 0;
+  for( i = 1; i < segment->length; i++, X1 = X2, Y1 = Y2 )
+  {
+    if( !cagdToWindow( &segment->where[ i ], &X2, &Y2 ) )
+      return 0;
+    dx = X2 - X1;
+    dy = Y2 - Y1;
+    len = dx * dx + dy * dy;
+    t = len > 0 ? ( ( x - X1 ) * dx + ( y - Y1 ) * dy ) / len : 0;
+    t = t < 0 ? 0 : t > 1 ? 1 : t;
+    px = X1 + t * dx - x;
+    py = Y1 + t * dy - y;
+    d = px * px + py * py;
+    if( minD < 0 || d < minD )
+    {
+      minD = d;
+      minI = i;
+    }
+  }
+  return minI;
+}
+
+BOOL isSegTableShown()
 {
+  return table == &defTable;
+}
+
+static void drawMesh( const SEGMENT *segment )
+{ /* wire frame, a closed loop per face */
+  const MESH *mesh = segment->mesh;
+  const UINT *index = mesh->indices;
+  UINT i, j;
+  for( i = 0; i < mesh->nFaces; i++ )
+  {
+    glBegin( GL_LINE_LOOP );
+    for( j = 0; j < mesh->faceSizes[ i ]; j++, index++ )
+    {
+      if( mesh->normals != NULL )
+        glNormal3dv( ( GLdouble * )&mesh->normals[ *index ] );
+      glVertex3dv( ( GLdouble * )&segment->where[ *index ] );
+    }
+    glEnd();
+  }
+}
+
+void drawSegments( GLenum mode )
+{ /* the window always shows the default table */
+  CAGD_SEG_TABLE *table = &defTable;
   UINT id, i;
   glClear( GL_COLOR_BUFFER_BIT );
   if( mode == GL_SELECT )
@@ -347,9 +859,9 @@ void drawSegments( GLenum mode )
     glInitNames();
     glPushName( 0 );
   }
-  for( id = 1; id < nSegments; id++ )
+  for( id = 1; id < table->nSegments; id++ )
   {
-    SEGMENT *segment = &list[ id ];
+    SEGMENT *segment = &table->list[ id ];
     if( segment->crv_type == CAGD_SEGMENT_UNUSED )
       continue;
     if( !segment->visible )
@@ -364,12 +876,47 @@ void drawSegments( GLenum mode )
       glVertex3dv( ( GLdouble * )segment->where );
       glEnd();
       break;
+    case CAGD_SEGMENT_POINTS:
+      if( mode == GL_SELECT )
+      {
+        glPushName( 0 );
+        for( i = 0; i < segment->length; i++ )
+        {
+          if( segment->pnt_flags && ( segment->pnt_flags[ i ] & PNT_HIDDEN ) )
+            continue;
+          glLoadName( i );
+          glBegin( GL_POINTS );
+          glVertex3dv( ( GLdouble * )&segment->where[ i ] );
+          glEnd();
+        }
+        glPopName();
+        break;
+      }
+      glBegin( GL_POINTS );
+      for( i = 0; i < segment->length; i++ )
+      {
+        if( segment->pnt_flags != NULL )
+        {
+          if( segment->pnt_flags[ i ] & PNT_HIDDEN )
+            continue;
+          if( segment->pnt_flags[ i ] & PNT_COLORED )
+            glColor3ubv( &segment->pnt_colors[ 3 * i ] );
+          else
+            glColor3ubv( segment->color_ );
+        }
+        glVertex3dv( ( GLdouble * )&segment->where[ i ] );
+      }
+      glEnd();
+      break;
     case CAGD_SEGMENT_POLYLINE:
       glBegin( GL_LINE_STRIP );
       for( i = 0; i < segment->length; i++ )
         glVertex3dv( ( GLdouble * )&segment->where[ i ] );
       glEnd();
       break;
+    case CAGD_SEGMENT_MESH:
+      drawMesh( segment );
+      break;
     case CAGD_SEGMENT_TEXT:
       if( mode == GL_SELECT )
         break;
@@ -0,0 +1,292 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "session.h"
+#include "crv_load.h"
+#include "crv_utils.h"
+#include "BSpline.h"
+#include "mapped_file.h"
+#include "options.h"
+#include "scene.h"
+
+static const char K_SESSION_MAGIC[ 8 ] = { 'C', 'A', 'G', 'D', 'S', 0, 0, 0 };
+
+/******************************************************************************
+* is_session_file_path
+******************************************************************************/
+bool is_session_file_path( const std::string &file_path )
+{
+  size_t ext_len = strlen( K_SESSION_EXT );
+
+  if( file_path.size() < ext_len )
+    return false;
+
+  return _stricmp( file_path.c_str() + file_path.size() - ext_len, K_SESSION_EXT ) == 0;
+}
+
+/******************************************************************************
+* save_session
+******************************************************************************/
+bool save_session( const std::string &file_path )
+{
+  const SlotMap< Curve * > &crvs = get_scene()->curves;
+  const SceneOptions &opts = get_scene()->opts;
+  uint32_t num_crvs = ( uint32_t )crvs.size();
+  std::vector< SessionCurve > dir( num_crvs );
+  std::vector< double > knots;
+  std::vector< CAGD_POINT > pnts;
+  std::vector< CAGD_POINT > samples;
+
+  for( uint32_t i = 0; i < num_crvs; ++i )
+  {
+    const Curve *p_crv = crvs[ i ];
+    SessionCurve &entry = dir[ i ];
+
+    memset( &entry, 0, sizeof( entry ) );
+    entry.first_knot = knots.size();
+    entry.first_pnt = pnts.size();
+    entry.first_sample = samples.size();
+    entry.num_pnts = ( uint32_t )p_crv->ctrl_pnts_.size();
+    entry.order = p_crv->order_;
+    entry.color[ 0 ] = p_crv->color_[ 0 ];
+    entry.color[ 1 ] = p_crv->color_[ 1 ];
+    entry.color[ 2 ] = p_crv->color_[ 2 ];
+
+    if( p_crv->kind_ == CurveType::BSPLINE )
+    {
+      const BSpline *p_bspline = static_cast< const BSpline * >( p_crv );
+
+      entry.num_knots = ( uint32_t )p_bspline->knots_.size();
+      entry.flags |= K_CAGDB_BSPLINE;
+
+      if( p_bspline->is_open_ )
+        entry.flags |= K_CAGDB_OPEN;
+
+      if( p_bspline->is_uni_ )
+        entry.flags |= K_CAGDB_UNI;
+
+      knots.insert( knots.end(), p_bspline->knots_.begin(), p_bspline->knots_.end() );
+    }
+
+    pnts.insert( pnts.end(), p_crv->ctrl_pnts_.begin(), p_crv->ctrl_pnts_.end() );
+
+    // the polyline as drawn, so loading does not sample again
+    if( !p_crv->seg_ids_.empty() )
+    {
+      UINT seg_id = p_crv->seg_ids_[ 0 ];
+      UINT length = cagdGetSegmentLength( seg_id );
+
+      samples.resize( samples.size() + length );
+      cagdGetSegmentLocation( seg_id, samples.data() + entry.first_sample );
+      entry.num_samples = length;
+
+      if( !cagdIsSegmentVisible( seg_id ) )
+        entry.flags |= K_SESSION_CRV_HIDDEN;
+    }
+
+    if( p_crv->poly_seg_id_ == K_NOT_USED || !cagdIsSegmentVisible( p_crv->poly_seg_id_ ) )
+      entry.flags |= K_SESSION_POLY_HIDDEN;
+  }
+
+  SessionHeader header;
+  CAGD_VIEW_STATE view_state;
+  uint64_t offset = sizeof( SessionHeader );
+
+  cagdGetViewState( &view_state );
+  memset( &header, 0, sizeof( header ) );
+  memcpy( header.magic, K_SESSION_MAGIC, sizeof( header.magic ) );
+  header.version = K_SESSION_VERSION;
+  header.header_size = sizeof( SessionHeader );
+  header.num_crvs = num_crvs;
+  header.num_steps = opts.num_steps;
+  header.def_degree = opts.def_degree;
+  memcpy( header.curve_color, opts.curve_color, sizeof( opts.curve_color ) );
+  header.hide_ctrl_polys = opts.hide_ctrl_polys;
+  header.pack_saves = opts.pack_saves;
+  header.pack_tol = opts.pack_tol;
+  header.view = view_state.view;
+  header.cue = view_state.cue;
+  header.fuzziness = view_state.fuzziness;
+  header.sensitive = view_state.sensitive;
+  memcpy( header.model_view, view_state.modelView, sizeof( header.model_view ) );
+
+  place_cagdb_section( header.dir, offset, num_crvs, sizeof( SessionCurve ) );
+  place_cagdb_section( header.knots, offset, knots.size(), sizeof( double ) );
+  place_cagdb_section( header.pnts, offset, pnts.size(), sizeof( CAGD_POINT ) );
+  place_cagdb_section( header.samples, offset, samples.size(), sizeof( CAGD_POINT ) );
+
+  // one buffer, one write
+  std::vector< char > buf( ( size_t )offset, 0 );
+
+  memcpy( buf.data(), &header, sizeof( header ) );
+  memcpy( buf.data() + header.dir.offset, dir.data(), dir.size() * sizeof( SessionCurve ) );
+  memcpy( buf.data() + header.knots.offset, knots.data(), knots.size() * sizeof( double ) );
+  memcpy( buf.data() + header.pnts.offset, pnts.data(), pnts.size() * sizeof( CAGD_POINT ) );
+  memcpy( buf.data() + header.samples.offset, samples.data(), samples.size() * sizeof( CAGD_POINT ) );
+
+  FILE *p_file = fopen( file_path.c_str(), "wb" );
+
+  if( p_file == NULL )
+  {
+    print_error( "Error opening file for writing" );
+    return false;
+  }
+
+  bool is_ok = fwrite( buf.data(), 1, buf.size(), p_file ) == buf.size();
+
+  if( fclose( p_file ) != 0 || !is_ok )
+  {
+    print_error( "Error writing file" );
+    return false;
+  }
+
+  return true;
+}
+
+/******************************************************************************
+* get_header
+******************************************************************************/
+static const SessionHeader *get_header( const MappedFile &file )
+{
+  const SessionHeader *p_header = ( const SessionHeader * )file.begin();
+
+  if( file.size() < sizeof( SessionHeader ) ||
+      memcmp( p_header->magic, K_SESSION_MAGIC, sizeof( K_SESSION_MAGIC ) ) != 0 )
+  {
+    print_error( "Not a session file" );
+    return nullptr;
+  }
+
+  if( p_header->version != K_SESSION_VERSION || p_header->header_size < sizeof( SessionHeader ) )
+  {
+    print_error( "Unsupported session version" );
+    return nullptr;
+  }
+
+  if( p_header->dir.count != p_header->num_crvs ||
+      !is_cagdb_section_valid( p_header->dir, file.size(), sizeof( SessionCurve ) ) ||
+      !is_cagdb_section_valid( p_header->knots, file.size(), sizeof( double ) ) ||
+      !is_cagdb_section_valid( p_header->pnts, file.size(), sizeof( CAGD_POINT ) ) ||
+      !is_cagdb_section_valid( p_header->samples, file.size(), sizeof( CAGD_POINT ) ) )
+  {
+    print_error( "Corrupt session file" );
+    return nullptr;
+  }
+
+  return p_header;
+}
+
+/******************************************************************************
+* is_entry_valid
+******************************************************************************/
+static bool is_entry_valid( const SessionHeader &header, const SessionCurve &entry )
+{
+  return entry.first_knot <= header.knots.count &&
+         entry.num_knots <= header.knots.count - entry.first_knot &&
+         entry.first_pnt <= header.pnts.count &&
+         entry.num_pnts <= header.pnts.count - entry.first_pnt &&
+         entry.first_sample <= header.samples.count &&
+         entry.num_samples <= header.samples.count - entry.first_sample &&
+         is_cagdb_shape_valid( entry.flags, entry.order, entry.num_knots, entry.num_pnts );
+}
+
+/******************************************************************************
+* load_session
+******************************************************************************/
+bool load_session( const std::string &file_path )
+{
+  auto start = std::chrono::steady_clock::now();
+  MappedFile file( file_path );
+
+  if( !file.is_mapped() )
+  {
+    print_error( "Error opening file" );
+    return false;
+  }
+
+  const SessionHeader *p_header = get_header( file );
+
+  if( p_header == nullptr )
+    return false;
+
+  const char *base = file.begin();
+  const SessionCurve *dir = ( const SessionCurve * )( base + p_header->dir.offset );
+  const double *knots = ( const double * )( base + p_header->knots.offset );
+  const CAGD_POINT *pnts = ( const CAGD_POINT * )( base + p_header->pnts.offset );
+  const CAGD_POINT *samples = ( const CAGD_POINT * )( base + p_header->samples.offset );
+
+  cancel_async_load();
+  clean_all_curves();
+
+  SceneOptions &opts = get_scene()->opts;
+  CAGD_VIEW_STATE view_state;
+
+  // the options first, registering the curves follows them
+  opts.num_steps = p_header->num_steps;
+  opts.def_degree = p_header->def_degree;
+  memcpy( opts.curve_color, p_header->curve_color, sizeof( opts.curve_color ) );
+  opts.hide_ctrl_polys = p_header->hide_ctrl_polys != 0;
+  opts.pack_saves = p_header->pack_saves != 0;
+  opts.pack_tol = p_header->pack_tol;
+
+  memcpy( view_state.modelView, p_header->model_view, sizeof( view_state.modelView ) );
+  view_state.sensitive = p_header->sensitive;
+  view_state.fuzziness = p_header->fuzziness;
+  view_state.view = p_header->view;
+  view_state.cue = p_header->cue;
+  cagdSetViewState( &view_state );
+
+  std::vector< Curve * > new_crvs;
+  std::vector< point_vec > crv_pnts;
+  std::vector< uint32_t > crv_flags;
+
+  new_crvs.reserve( p_header->num_crvs );
+  crv_pnts.reserve( p_header->num_crvs );
+  crv_flags.reserve( p_header->num_crvs );
+
+  for( uint32_t i = 0; i < p_header->num_crvs; ++i )
+  {
+    const SessionCurve &entry = dir[ i ];
+
+    if( !is_entry_valid( *p_header, entry ) )
+    {
+      print_error( "Corrupt session curve" );
+      continue;
+    }
+
+    Curve *p_crv = new_cagdb_curve( entry.flags, entry.order,
+                                    knots + entry.first_knot, entry.num_knots );
+
+    p_crv->ctrl_pnts_.assign( pnts + entry.first_pnt, pnts + entry.first_pnt + entry.num_pnts );
+    p_crv->color_[ 0 ] = entry.color[ 0 ];
+    p_crv->color_[ 1 ] = entry.color[ 1 ];
+    p_crv->color_[ 2 ] = entry.color[ 2 ];
+
+    const CAGD_POINT *crv_samples = samples + entry.first_sample;
+
+    new_crvs.push_back( p_crv );
+    crv_pnts.emplace_back( crv_samples, crv_samples + entry.num_samples );
+    crv_flags.push_back( entry.flags );
+  }
+
+  register_sampled_crvs( new_crvs, crv_pnts );
+
+  for( size_t i = 0; i < new_crvs.size(); ++i )
+  {
+    if( ( crv_flags[ i ] & K_SESSION_CRV_HIDDEN ) && !new_crvs[ i ]->seg_ids_.empty() )
+      cagdHideSegment( new_crvs[ i ]->seg_ids_[ 0 ] );
+
+    if( ( crv_flags[ i ] & K_SESSION_POLY_HIDDEN ) && !opts.hide_ctrl_polys )
+      new_crvs[ i ]->hide_ctrl_poly();
+  }
+
+  cagdRedraw();
+
+  std::chrono::duration< double > secs = std::chrono::steady_clock::now() - start;
+
+  printf( "Loaded session of %zu curves in %.3f s\n", new_crvs.size(), secs.count() );
+
+  return true;
+}
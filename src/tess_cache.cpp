@@ -0,0 +1,339 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#include "tess_cache.h"
+#include "crv_utils.h"
+#include "BSpline.h"
+#include "options.h"
+
+#define K_TESS_CACHE_VERSION 2
+#define K_TESS_CACHE_MAX_SIZE ( 1024L * 1024L * 1024L )
+
+static const char K_TESS_CACHE_MAGIC[ 8 ] = { 'C', 'A', 'G', 'D', 'T', 0, 0, 0 };
+
+typedef struct
+{
+  char magic[ 8 ]; // "CAGDT" padded with zeros
+  uint32_t version;
+  uint32_t point_size; // sizeof( CAGD_POINT ) of the writer
+} TessCacheHeader;
+
+// compared on lookup, so a key collision of different curves is a miss
+typedef struct
+{
+  int32_t order;
+  uint32_t num_pnts;
+  uint32_t num_knots;
+} TessCacheCrv;
+
+typedef struct
+{
+  uint64_t key;
+  TessCacheCrv crv;
+  uint32_t num_samples;
+  uint32_t check;
+  uint32_t unused;
+} TessCacheRecord;
+
+typedef struct
+{
+  long offset; // of the samples
+  TessCacheCrv crv;
+  uint32_t num_samples;
+  uint32_t check;
+} TessCacheEntry;
+
+static std::mutex g_mtx;
+static FILE *g_p_file = nullptr;
+static long g_end = 0; // where the next record goes
+static std::unordered_map< uint64_t, TessCacheEntry > g_index;
+
+/******************************************************************************
+* hash_bytes
+******************************************************************************/
+// FNV-1a, 64 bit
+static uint64_t hash_bytes( uint64_t hash, const void *p_data, size_t size )
+{
+  const uint8_t *p = ( const uint8_t * )p_data;
+
+  for( size_t i = 0; i < size; ++i )
+    hash = ( hash ^ p[ i ] ) * 1099511628211ull;
+
+  return hash;
+}
+
+/******************************************************************************
+* checksum
+******************************************************************************/
+static uint32_t checksum( const CAGD_POINT *pnts, size_t num )
+{
+  uint64_t hash = hash_bytes( 14695981039346656037ull, pnts, num * sizeof( CAGD_POINT ) );
+
+  return ( uint32_t )( hash ^ ( hash >> 32 ) );
+}
+
+/******************************************************************************
+* get_key
+******************************************************************************/
+static uint64_t get_key( const Curve *p_crv, uint32_t num_samples )
+{
+  uint64_t hash = 14695981039346656037ull;
+  int32_t kind = ( int32_t )p_crv->kind_;
+  int32_t order = p_crv->order_;
+  uint32_t num_pnts = ( uint32_t )p_crv->ctrl_pnts_.size();
+
+  hash = hash_bytes( hash, &kind, sizeof( kind ) );
+  hash = hash_bytes( hash, &order, sizeof( order ) );
+  hash = hash_bytes( hash, &num_samples, sizeof( num_samples ) );
+  hash = hash_bytes( hash, &num_pnts, sizeof( num_pnts ) );
+  hash = hash_bytes( hash, p_crv->ctrl_pnts_.data(), num_pnts * sizeof( CAGD_POINT ) );
+
+  if( p_crv->kind_ == CurveType::BSPLINE )
+  {
+    const double_vec &knots = static_cast< const BSpline * >( p_crv )->knots_;
+    uint32_t num_knots = ( uint32_t )knots.size();
+
+    hash = hash_bytes( hash, &num_knots, sizeof( num_knots ) );
+    hash = hash_bytes( hash, knots.data(), num_knots * sizeof( double ) );
+  }
+
+  return hash;
+}
+
+/******************************************************************************
+* get_crv
+******************************************************************************/
+static TessCacheCrv get_crv( const Curve *p_crv )
+{
+  TessCacheCrv crv;
+
+  crv.order = p_crv->order_;
+  crv.num_pnts = ( uint32_t )p_crv->ctrl_pnts_.size();
+  crv.num_knots = 0;
+
+  if( p_crv->kind_ == CurveType::BSPLINE )
+    crv.num_knots = ( uint32_t )static_cast< const BSpline * >( p_crv )->knots_.size();
+
+  return crv;
+}
+
+/******************************************************************************
+* same_crv
+******************************************************************************/
+static bool same_crv( const TessCacheCrv &crv_1, const TessCacheCrv &crv_2 )
+{
+  return crv_1.order == crv_2.order &&
+         crv_1.num_pnts == crv_2.num_pnts &&
+         crv_1.num_knots == crv_2.num_knots;
+}
+
+/******************************************************************************
+* read_index
+******************************************************************************/
+static void read_index()
+{
+  TessCacheRecord rec;
+  long offset = sizeof( TessCacheHeader );
+
+  fseek( g_p_file, 0, SEEK_END );
+  long file_size = ftell( g_p_file );
+
+  while( offset + ( long )sizeof( rec ) <= file_size )
+  {
+    fseek( g_p_file, offset, SEEK_SET );
+
+    if( fread( &rec, sizeof( rec ), 1, g_p_file ) != 1 || rec.num_samples == 0 ||
+        rec.num_samples > ( uint32_t )( ( file_size - offset - sizeof( rec ) ) / sizeof( CAGD_POINT ) ) )
+      break;
+
+    long next = offset + ( long )( sizeof( rec ) + rec.num_samples * sizeof( CAGD_POINT ) );
+
+    g_index[ rec.key ] = { offset + ( long )sizeof( rec ), rec.crv, rec.num_samples, rec.check };
+    offset = next;
+  }
+
+  // a torn last record is written over
+  g_end = offset;
+}
+
+/******************************************************************************
+* tess_cache_open
+******************************************************************************/
+bool tess_cache_open( const std::string &file_path )
+{
+  std::lock_guard< std::mutex > lock( g_mtx );
+  TessCacheHeader header;
+
+  if( g_p_file != nullptr )
+    return true;
+
+  g_p_file = fopen( file_path.c_str(), "r+b" );
+
+  if( g_p_file != nullptr )
+  {
+    if( fread( &header, sizeof( header ), 1, g_p_file ) != 1 ||
+        memcmp( header.magic, K_TESS_CACHE_MAGIC, sizeof( header.magic ) ) != 0 ||
+        header.version != K_TESS_CACHE_VERSION ||
+        header.point_size != sizeof( CAGD_POINT ) )
+    {
+      // another version of the cache, start over
+      fclose( g_p_file );
+      g_p_file = nullptr;
+    }
+  }
+
+  if( g_p_file == nullptr )
+  {
+    g_p_file = fopen( file_path.c_str(), "w+b" );
+
+    if( g_p_file == nullptr )
+    {
+      print_error( "Error opening tessellation cache" );
+      return false;
+    }
+
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.magic, K_TESS_CACHE_MAGIC, sizeof( header.magic ) );
+    header.version = K_TESS_CACHE_VERSION;
+    header.point_size = sizeof( CAGD_POINT );
+
+    if( fwrite( &header, sizeof( header ), 1, g_p_file ) != 1 )
+    {
+      print_error( "Error writing tessellation cache" );
+      fclose( g_p_file );
+      g_p_file = nullptr;
+      return false;
+    }
+  }
+
+  read_index();
+
+  return true;
+}
+
+/******************************************************************************
+* tess_cache_close
+******************************************************************************/
+void tess_cache_close()
+{
+  std::lock_guard< std::mutex > lock( g_mtx );
+
+  if( g_p_file == nullptr )
+    return;
+
+  fclose( g_p_file );
+  g_p_file = nullptr;
+  g_index.clear();
+  g_end = 0;
+}
+
+/******************************************************************************
+* tess_cache_is_open
+******************************************************************************/
+bool tess_cache_is_open()
+{
+  std::lock_guard< std::mutex > lock( g_mtx );
+
+  return g_p_file != nullptr;
+}
+
+/******************************************************************************
+* find_locked
+******************************************************************************/
+static bool find_locked( uint64_t key, const TessCacheCrv &crv, point_vec &pnts )
+{
+  auto it = g_index.find( key );
+
+  if( it == g_index.end() || !same_crv( it->second.crv, crv ) )
+    return false;
+
+  const TessCacheEntry &entry = it->second;
+
+  pnts.resize( entry.num_samples );
+
+  if( fseek( g_p_file, entry.offset, SEEK_SET ) != 0 ||
+      fread( pnts.data(), sizeof( CAGD_POINT ), entry.num_samples, g_p_file ) != entry.num_samples ||
+      checksum( pnts.data(), pnts.size() ) != entry.check )
+  {
+    g_index.erase( it );
+    pnts.clear();
+    return false;
+  }
+
+  return true;
+}
+
+/******************************************************************************
+* add_locked
+******************************************************************************/
+static void add_locked( uint64_t key, const TessCacheCrv &crv, const point_vec &pnts )
+{
+  TessCacheRecord rec;
+  long samples_size = ( long )( pnts.size() * sizeof( CAGD_POINT ) );
+
+  if( pnts.empty() || g_end + ( long )sizeof( rec ) + samples_size > K_TESS_CACHE_MAX_SIZE )
+    return;
+
+  rec.key = key;
+  rec.crv = crv;
+  rec.num_samples = ( uint32_t )pnts.size();
+  rec.check = checksum( pnts.data(), pnts.size() );
+  rec.unused = 0;
+
+  // a failed write is not indexed and the next one goes over it
+  if( fseek( g_p_file, g_end, SEEK_SET ) != 0 ||
+      fwrite( &rec, sizeof( rec ), 1, g_p_file ) != 1 ||
+      fwrite( pnts.data(), sizeof( CAGD_POINT ), pnts.size(), g_p_file ) != pnts.size() )
+    return;
+
+  g_index[ key ] = { g_end + ( long )sizeof( rec ), crv, rec.num_samples, rec.check };
+  g_end += ( long )sizeof( rec ) + samples_size;
+}
+
+/******************************************************************************
+* tess_cache_find
+******************************************************************************/
+bool tess_cache_find( const Curve *p_crv, point_vec &pnts )
+{
+  std::lock_guard< std::mutex > lock( g_mtx );
+
+  if( g_p_file == nullptr )
+    return false;
+
+  return find_locked( get_key( p_crv, get_default_num_steps() ), get_crv( p_crv ), pnts );
+}
+
+/******************************************************************************
+* tess_cache_sample
+******************************************************************************/
+bool tess_cache_sample( const Curve *p_crv, point_vec &pnts )
+{
+  uint64_t key;
+  TessCacheCrv crv = get_crv( p_crv );
+
+  {
+    std::lock_guard< std::mutex > lock( g_mtx );
+
+    if( g_p_file == nullptr )
+      return p_crv->sample_crv( pnts );
+
+    key = get_key( p_crv, get_default_num_steps() );
+
+    if( find_locked( key, crv, pnts ) )
+      return true;
+  }
+
+  // sampled outside of the lock, other threads keep reading the cache
+  if( !p_crv->sample_crv( pnts ) )
+    return false;
+
+  std::lock_guard< std::mutex > lock( g_mtx );
+
+  if( g_p_file != nullptr )
+    add_locked( key, crv, pnts );
+
+  return true;
+}
@@ -0,0 +1,134 @@
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "text_writer.h"
+#include "Curve.h"
+#include "crv_utils.h"
+
+#define K_CHUNK_PNTS ( 1 << 15 ) // control points formatted per chunk
+#define K_NUM_CHARS 32 // enough for any double or integer
+
+/******************************************************************************
+* TextBuffer::put
+******************************************************************************/
+void TextBuffer::put( const char *str )
+{
+  buf_.insert( buf_.end(), str, str + strlen( str ) );
+}
+
+/******************************************************************************
+* TextBuffer::put_int
+******************************************************************************/
+void TextBuffer::put_int( long long val )
+{
+  char chars[ K_NUM_CHARS ];
+  auto res = std::to_chars( chars, chars + K_NUM_CHARS, val );
+
+  buf_.insert( buf_.end(), chars, res.ptr );
+}
+
+/******************************************************************************
+* TextBuffer::put_double
+******************************************************************************/
+void TextBuffer::put_double( double val )
+{
+  char chars[ K_NUM_CHARS ];
+  auto res = std::to_chars( chars, chars + K_NUM_CHARS, val );
+
+  buf_.insert( buf_.end(), chars, res.ptr );
+}
+
+/******************************************************************************
+* split_chunks
+******************************************************************************/
+// chunk i is crvs[ bounds[ i ] ] up to crvs[ bounds[ i + 1 ] ]
+static std::vector< size_t > split_chunks( const std::vector< const Curve * > &crvs )
+{
+  std::vector< size_t > bounds( 1, 0 );
+  size_t num_pnts = 0;
+
+  for( size_t i = 0; i < crvs.size(); ++i )
+  {
+    num_pnts += crvs[ i ]->ctrl_pnts_.size() + 1;
+
+    if( num_pnts >= K_CHUNK_PNTS )
+    {
+      bounds.push_back( i + 1 );
+      num_pnts = 0;
+    }
+  }
+
+  if( bounds.back() != crvs.size() )
+    bounds.push_back( crvs.size() );
+
+  return bounds;
+}
+
+/******************************************************************************
+* format_chunk
+******************************************************************************/
+static void format_chunk( const std::vector< const Curve * > &crvs,
+                          size_t begin,
+                          size_t end,
+                          TextBuffer *p_buf )
+{
+  p_buf->clear();
+
+  for( size_t i = begin; i < end; ++i )
+    crvs[ i ]->dump( *p_buf );
+}
+
+/******************************************************************************
+* write_crvs_text
+******************************************************************************/
+bool write_crvs_text( const std::string &file_path,
+                      const std::vector< const Curve * > &crvs )
+{
+  FILE *p_file = fopen( file_path.c_str(), "wb" );
+
+  if( p_file == NULL )
+  {
+    print_error( "Error opening file for writing" );
+    return false;
+  }
+
+  std::vector< size_t > bounds = split_chunks( crvs );
+  size_t num_chunks = bounds.size() - 1;
+  size_t num_threads = min( ( size_t )max( 1u, std::thread::hardware_concurrency() ), num_chunks );
+  std::vector< TextBuffer > bufs( max( num_threads, ( size_t )1 ) );
+  bool is_ok = true;
+
+  // format a wave of chunks in parallel, then write them out in order
+  for( size_t first = 0; first < num_chunks && is_ok; first += bufs.size() )
+  {
+    size_t num_wave = min( bufs.size(), num_chunks - first );
+    std::vector< std::thread > threads;
+
+    for( size_t i = 1; i < num_wave; ++i )
+    {
+      threads.emplace_back( format_chunk,
+                            std::cref( crvs ),
+                            bounds[ first + i ],
+                            bounds[ first + i + 1 ],
+                            &bufs[ i ] );
+    }
+
+    format_chunk( crvs, bounds[ first ], bounds[ first + 1 ], &bufs[ 0 ] );
+
+    for( auto &thread : threads )
+      thread.join();
+
+    for( size_t i = 0; i < num_wave && is_ok; ++i )
+      is_ok = fwrite( bufs[ i ].data(), 1, bufs[ i ].size(), p_file ) == bufs[ i ].size();
+  }
+
+  if( fclose( p_file ) != 0 )
+    is_ok = false;
+
+  if( !is_ok )
+    print_error( "Error writing file" );
+
+  return is_ok;
+}